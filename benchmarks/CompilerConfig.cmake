@@ -27,4 +27,11 @@ else(UNIX)
   SET (WIN_LIBRARIES "")
 endif(UNIX)
 
-link_libraries(papi ${UNIX_LIBRARIES})
+link_libraries(${UNIX_LIBRARIES})
+
+# count hardware events through PAPI rather than perf_event: -DADHD_PAPI=ON
+option(ADHD_PAPI "count hardware events through PAPI" OFF)
+if (ADHD_PAPI)
+  add_definitions(-DADHD_PAPI)
+  link_libraries(papi)
+endif()
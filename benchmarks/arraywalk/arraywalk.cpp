@@ -4,11 +4,17 @@
 #include <iostream>
 #include <random>
 #include <stdexcept>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 #include "arraywalk.hpp"
 #include "../benchmark.hpp"
-#include "../rdtsc.h"
+#include "../cycle.hpp"
+#include "../kernels.hpp"
+#include "../memory.hpp"
+#include "../statistics.hpp"
+#include "../timers.hpp"
 #include "timings.hpp"
 #include "util.hpp"
 
@@ -33,6 +39,18 @@ namespace arraywalk {
 	static const char NOT_POW2_ALIGN[] =
 		"Requested memory alignment for the walking array is not a power of two.";
 
+	// Nodes must hold at least an index, and may span at most a (small) page.
+	static const char NODE_SIZE_RANGE[] =
+		"Requested node size is not a power of two between the index size and 4 KiB.";
+
+	// The payload is stored in the node, after its index.
+	static const char PAYLOAD_TOO_LARGE[] =
+		"Requested payload does not fit in a node next to the index.";
+
+	// Updating accesses store to the payload, never to the links.
+	static const char NEED_PAYLOAD[] =
+		"Updating accesses require a payload to update.";
+
 	// Default-constructed class does not have an array to walk, and walking it
 	// is therefore impossible.
 	static const char NOT_INITIALIZED[] =
@@ -42,23 +60,31 @@ namespace arraywalk {
 	ArrayWalk<INDEX_T>::ArrayWalk(const Config & cfg):
 		config(cfg),
 		length(0),
-		arraymem(NULL),
-		array(NULL)
+		nodes(0),
+		stride(1),
+		words(0),
+		spread(1),
+		lanes(1),
+		arraymem(),
+		array(NULL),
+		repetition()
 	{}
 
 	template <typename INDEX_T>
 	ArrayWalk<INDEX_T>::~ArrayWalk()
-	{
-		delete[] arraymem;
-	}
+	{}
 
 	template <typename INDEX_T>
 	void ArrayWalk<INDEX_T>::run(timing_cb tcb)
 	{
-		for (size_t size = config.size_min;
-				size <= config.size_max;
-				size = size * config.size_mul + config.size_inc)
-		{
+		// sizes as in for (size = min; size <= max; size = size * mul + inc),
+		// possibly refined using the measured latencies
+		AdaptiveStepper<size_t> sizes(config.size_min, config.size_max,
+				config.size_mul, config.size_inc, config.size_threshold,
+				config.size_resolution, config.size_budget, defaults::size_granule);
+		for (sizes.gotoBegin(); ; ) {
+			const size_t size = sizes.getValue();
+			const uint64_t setupStart = timers::Default::now();
 			length = size / sizeof(INDEX_T);
 
 			/* icpc warns about implicit conversion, which is rather odd when doing
@@ -82,26 +108,57 @@ namespace arraywalk {
 			if (rep_length != length)
 				throw length_error(NOT_INDEXABLE);
 
-			if (length < 4)
+			if (config.node_size < sizeof(INDEX_T)
+					|| config.node_size > defaults::node_size_max
+					|| !util::isPowerOfTwo<size_t>(config.node_size))
+				throw domain_error(NODE_SIZE_RANGE);
+
+			if (config.payload > config.node_size - sizeof(INDEX_T))
+				throw domain_error(PAYLOAD_TOO_LARGE);
+
+			stride = config.node_size / sizeof(INDEX_T);
+			words = (config.payload + sizeof(INDEX_T) - 1) / sizeof(INDEX_T);
+			nodes = length / stride;
+
+			if (kernels::Access::READ != config.access && 0 == words)
+				throw domain_error(NEED_PAYLOAD);
+
+			if (nodes < 4)
 				throw length_error(NEED_FOUR_ELEMENTS);
 
 			if (!util::isPowerOfTwo<size_t>(config.align))
 				throw domain_error(NOT_POW2_ALIGN);
 
-			// allocate with overhead to cater for later alignment
-			// arraymem must be NULL or previously allocated by this function
-			const size_t overhead = 1 + config.align / sizeof(INDEX_T);
-			delete[] arraymem;
-			arraymem = new INDEX_T[length + overhead];
-			const uintptr_t aligned =
-				(reinterpret_cast<uintptr_t>(arraymem) + config.align) & (~(config.align - 1));
-			array = reinterpret_cast<INDEX_T *>(aligned);
+			// the array at the start of the arena, using the requested page size,
+			// which may fall back to smaller pages: the obtained backing is
+			// reported in the timings. Only the pages a larger size adds are
+			// faulted, here rather than while walking.
+			arraymem.reserve(config.size_max, config.align, config.pages);
+			arraymem.reset();
+			array = static_cast<INDEX_T *>(
+					arraymem.window(length * sizeof(INDEX_T), config.align, config.pages));
+			arraymem.populate(array, length * sizeof(INDEX_T));
+
+			// one node per page for RANDOM_PAGES, at an offset that shifts by one
+			// node every page; the page size is only known after mapping
+			spread = stride;
+			lanes = 1;
+			if (RANDOM_PAGES == config.ptrn) {
+				spread = pageSize(arraymem.backing()) / sizeof(INDEX_T);
+				lanes = spread / stride;
+				nodes = length / spread;
+				if (nodes < 4)
+					throw length_error(NEED_FOUR_ELEMENTS);
+			}
 
 			switch (config.ptrn) {
 				case RANDOM: random(); break;
 				case INCREASING: increasing(); break;
 				case DECREASING: decreasing(); break;
+				case RANDOM_IN_PAGE: randomInPage(); break;
+				case RANDOM_PAGES: randomPages(); break;
 			}
+			const uint64_t setupCycles = timers::Default::now() - setupStart;
 
 			uint64_t cycles;
 			uint64_t reads;
@@ -110,9 +167,34 @@ namespace arraywalk {
 					istream <= config.istream_max;
 					++istream)
 			{
-				timedwalk_loc(istream, config.MiB, cycles, reads);
-				tcb(Timings(TimingData { cycles, reads, length, sizeof(INDEX_T), istream }));
+				repetition.restart();
+				do {
+					timedwalk_loc(istream, config.MiB, cycles, reads);
+					repetition.add((double) cycles / (double) reads);
+				} while (config.repeat && !repetition.endRun());
+
+				const Timings timings(TimingData {
+						cycles, reads, config.ptrn, config.access, length, sizeof(INDEX_T),
+						config.node_size, config.payload, istream, arraymem.backing(), setupCycles
+						});
+				if (config.repeat) {
+					if (config.istream_min == istream)
+						sizes.record(size, repetition.summary().median);
+					statistics::Summary summary(timings);
+					summary.setData(repetition.summary());
+					tcb(summary);
+				}
+				else {
+					if (config.istream_min == istream)
+						sizes.record(size, (double) cycles / (double) reads);
+					tcb(timings);
+				}
 			}
+
+			// the sweep is done when the sizes wrap around
+			sizes.next();
+			if (sizes.atMin())
+				break;
 		}
 	}
 
@@ -126,7 +208,7 @@ namespace arraywalk {
 	__uint128_t ArrayWalk<__uint128_t>::randomIndex(__uint128_t minimum)
 	{
 		const uint64_t min = static_cast<uint64_t>(minimum);
-		const uint64_t max = static_cast<uint64_t>(length - 1);
+		const uint64_t max = static_cast<uint64_t>(nodes - 1);
 		uniform_int_distribution<uint64_t> dis(min, max);
 		return dis(rng);
 	}
@@ -139,7 +221,7 @@ namespace arraywalk {
 #pragma warning(push)
 #pragma warning(disable:1682)
 #endif
-		const INDEX_T maximum = static_cast<INDEX_T>(length - 1);
+		const INDEX_T maximum = static_cast<INDEX_T>(nodes - 1);
 #ifdef __INTEL_COMPILER
 #pragma warning(pop)
 #endif
@@ -147,69 +229,73 @@ namespace arraywalk {
 		return dis(rng);
 	}
 
+	// generate the random cycle using all hardware threads, see CycleGenerator
 	template <typename INDEX_T>
 	void ArrayWalk<INDEX_T>::random()
 	{
-		if (0 == length)
+		if (0 == nodes)
 			return;
 
-		// initialization step encodes index as values
-		for (INDEX_T idx = 0; idx < length; ++idx)
-			array[idx] = idx;
-
-		// shuffle the array
-		// idx goes up to the penultimate element because element at idx is
-		// swapped with an element at > idx
-		INDEX_T rnd;
-		INDEX_T swap;
-		for (INDEX_T idx = 0; idx < length - 1; ++idx) {
-			rnd = randomIndex(static_cast<INDEX_T>(idx + 1));
-			swap = array[idx];
-			array[idx] = array[rnd];
-			array[rnd] = swap;
-		}
+		const unsigned hwthreads = thread::hardware_concurrency();
+		CycleGenerator<INDEX_T> cycle(array, nodes, stride, hwthreads ? hwthreads : 1,
+				defaults::seed);
+		vector<thread> threads;
+		for (unsigned part = 1; part < cycle.numParts(); ++part)
+			threads.emplace_back(&CycleGenerator<INDEX_T>::generate, &cycle, part);
+		cycle.generate(0);
+		for (auto & thr: threads)
+			thr.join();
+		cycle.stitch();
 	}
 
 	template <typename INDEX_T>
 	void ArrayWalk<INDEX_T>::increasing()
 	{
-		INDEX_T idx;
-		for (idx = 0; idx < length - 1; ++idx)
-			array[idx] = static_cast<INDEX_T>(idx + 1);
-		array[idx] = 0;
+		size_t node;
+		for (node = 0; node < nodes - 1; ++node)
+			link(node, node + 1);
+		link(node, 0);
 	}
 
 	template <typename INDEX_T>
 	void ArrayWalk<INDEX_T>::decreasing()
 	{
-		/* see disable:1682 above */
-#ifdef __INTEL_COMPILER
-#pragma warning(push)
-#pragma warning(disable:1682)
-#endif
-		const INDEX_T maximum = static_cast<INDEX_T>(length - 1);
-#ifdef __INTEL_COMPILER
-#pragma warning(pop)
-#endif
-		array[0] = maximum;
-		for (INDEX_T idx = 1; idx < length; ++idx)
-			array[idx] = static_cast<INDEX_T>(idx - 1);
+		link(0, nodes - 1);
+		for (size_t node = 1; node < nodes; ++node)
+			link(node, node - 1);
+	}
+
+	// random lines within a page: walks the pages sequentially
+	template <typename INDEX_T>
+	void ArrayWalk<INDEX_T>::randomInPage()
+	{
+		const size_t perPage = pageSize(arraymem.backing()) / config.node_size;
+		blockCycle(nodes, perPage, defaults::seed,
+				[this] (size_t from, size_t to) { link(from, to); });
+	}
+
+	// random pages, one node per page: see the layout set up by run()
+	template <typename INDEX_T>
+	void ArrayWalk<INDEX_T>::randomPages()
+	{
+		randomCycle(nodes, defaults::seed,
+				[this] (size_t from, size_t to) { link(from, to); });
 	}
 
 	template <typename INDEX_T>
 	bool ArrayWalk<INDEX_T>::isFullCycle()
 	{
-		INDEX_T i, idx;
-		bool * visited = new bool[length];
+		size_t i, idx;
+		bool * visited = new bool[nodes];
 		bool allVisited = true;
 
-		for (idx = 0; idx < length; ++idx)
+		for (idx = 0; idx < nodes; ++idx)
 			visited[idx] = false;
 
-		for (i = 0, idx = 0; i < length; ++i, idx = array[idx])
-			visited[idx] = true;
+		for (i = 0, idx = 0; i < nodes; ++i, idx = static_cast<size_t>(array[idx]))
+			visited[idx / spread] = true;
 
-		for (idx = 0; idx < length; ++idx)
+		for (idx = 0; idx < nodes; ++idx)
 			if (!visited[idx]) {
 				allVisited = false;
 				break;
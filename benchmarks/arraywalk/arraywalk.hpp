@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../benchmark.hpp"
+#include "../cycle.hpp"
+#include "../memory.hpp"
+#include "../statistics.hpp"
 #include "config.hpp"
 #include "timings.hpp"
 
@@ -9,9 +12,6 @@
 #include <functional>
 #include <random>
 
-#define TIMEDWALK_LOC_DEC(NUM) \
-	INDEX_T timedwalk_loc##NUM(uint_fast32_t, uint64_t &, uint64_t &)
-
 namespace arraywalk {
 
 	template <typename INDEX_T>
@@ -26,8 +26,20 @@ namespace arraywalk {
 			private:
 				Config config;
 				size_t length;
-				INDEX_T * arraymem;
+				// the array is walked in nodes of 'stride' indices, of which the first
+				// links to the next node and the following 'words' are payload
+				size_t nodes;
+				size_t stride;
+				size_t words;
+				// node n starts at array index n * spread + (n % lanes) * stride, see
+				// the RANDOM_PAGES pattern; nodes are contiguous when spread == stride
+				size_t spread;
+				size_t lanes;
+				// reserved for the largest size, reused by every size
+				adhd::Arena arraymem;
 				INDEX_T * array;
+				// stopping rule for config.repeat
+				adhd::statistics::Repetition repetition;
 
 				INDEX_T timedwalk_loc(unsigned locs, uint_fast32_t MiB,
 						uint64_t & cycles, uint64_t & reads);
@@ -37,31 +49,21 @@ namespace arraywalk {
 				void random();
 				void increasing();
 				void decreasing();
+				void randomInPage();
+				void randomPages();
+
+				inline size_t slot(size_t node) const {
+					return node * spread + (node % lanes) * stride;
+				}
+
+				// point node 'from' to node 'to'
+				inline void link(size_t from, size_t to) {
+					array[slot(from)] = static_cast<INDEX_T>(slot(to));
+				}
 
 				bool isFullCycle();
 
 				std::default_random_engine rng;
 				INDEX_T randomIndex(INDEX_T minimum);
-
-				TIMEDWALK_LOC_DEC(1);
-				TIMEDWALK_LOC_DEC(2);
-				TIMEDWALK_LOC_DEC(3);
-				TIMEDWALK_LOC_DEC(4);
-				TIMEDWALK_LOC_DEC(5);
-				TIMEDWALK_LOC_DEC(6);
-				TIMEDWALK_LOC_DEC(7);
-				TIMEDWALK_LOC_DEC(8);
-				TIMEDWALK_LOC_DEC(9);
-				TIMEDWALK_LOC_DEC(10);
-				TIMEDWALK_LOC_DEC(11);
-				TIMEDWALK_LOC_DEC(12);
-				TIMEDWALK_LOC_DEC(13);
-				TIMEDWALK_LOC_DEC(14);
-				TIMEDWALK_LOC_DEC(15);
-				TIMEDWALK_LOC_DEC(16);
-				TIMEDWALK_LOC_DEC(17);
-				TIMEDWALK_LOC_DEC(18);
-				TIMEDWALK_LOC_DEC(19);
-				TIMEDWALK_LOC_DEC(20);
 		};
 }
@@ -2,21 +2,48 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <iostream>
+
+using namespace std;
 
 // TODO type conversions: bounds checking
 namespace arraywalk {
+	ostream & operator<<(ostream & os, const pattern & p) {
+		const char * str;
+		switch (p) {
+			case RANDOM: str = "random"; break;
+			case INCREASING: str = "increasing"; break;
+			case DECREASING: str = "decreasing"; break;
+			case RANDOM_IN_PAGE: str = "random in page"; break;
+			case RANDOM_PAGES: str = "random pages"; break;
+			default: str = "<unknown>"; break;
+		}
+		return os << str;
+	}
+
 	Config::Config( size_t _size_min, size_t _size_max, unsigned _size_mul, size_t _size_inc,
 			unsigned _istream_min, unsigned _istream_max,
-			uintptr_t _align, pattern _ptrn, uint_fast32_t _MiB):
+			uintptr_t _align, pattern _ptrn, uint_fast32_t _MiB,
+			adhd::PageBacking _pages, size_t _node_size, size_t _payload,
+			double _size_threshold, double _size_resolution, double _size_budget,
+			adhd::kernels::Access _access, bool _repeat):
 		size_min(_size_min),
 		size_max(_size_max),
 		size_mul(_size_mul),
 		size_inc(_size_inc),
+		size_threshold(_size_threshold),
+		size_resolution(_size_resolution),
+		size_budget(_size_budget),
 		istream_min(_istream_min),
 		istream_max(_istream_max),
 		align(_align),
 		ptrn(_ptrn),
-		MiB(_MiB)
+		MiB(_MiB),
+		pages(_pages),
+		node_size(_node_size),
+		payload(_payload),
+		access(_access),
+		repeat(_repeat)
 	{
 		// TODO: argument validity checks
 	}
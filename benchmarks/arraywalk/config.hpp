@@ -1,21 +1,38 @@
 #pragma once
 
 #include "../benchmark.hpp"
+#include "../kernels.hpp"
+#include "../memory.hpp"
 
 // TODO libconfig as backend
 
 #include <cstddef>
 #include <cstdint>
+#include <iostream>
 
 namespace arraywalk {
 
-	enum pattern { RANDOM, INCREASING, DECREASING };
+	// Access patterns; besides the plain random and sequential walks:
+	// RANDOM_IN_PAGE - random order over the nodes inside a page, pages walked
+	//                  sequentially: cache misses with few TLB misses
+	// RANDOM_PAGES   - random order over pages, touching a single node per page
+	//                  (staggered over pages to avoid cache set conflicts):
+	//                  a TLB miss on every hop once the pages exceed the TLB reach
+	enum pattern { RANDOM, INCREASING, DECREASING, RANDOM_IN_PAGE, RANDOM_PAGES };
+
+	std::ostream & operator<<(std::ostream & os, const pattern & p);
 
 	namespace defaults {
 		static constexpr size_t size_min = 1 << 12;
 		static constexpr size_t size_max = 1 << 14;
 		static constexpr unsigned size_mul = 1;
 		static constexpr size_t size_inc = 1 << 12;
+		// adaptive refinement of the size sweep, see adhd::AdaptiveStepper:
+		// disabled by default
+		static constexpr double size_threshold = 0;
+		static constexpr double size_resolution = 0.05;
+		static constexpr double size_budget = 0;
+		static constexpr size_t size_granule = 1 << 12;
 
 		static constexpr unsigned istream_min = 1;
 		static constexpr unsigned istream_max = 5;
@@ -23,8 +40,35 @@ namespace arraywalk {
 		static constexpr uintptr_t align = 1 << 12;
 
 		static constexpr pattern ptrn = RANDOM;
+		static constexpr uint64_t seed = 0x5eed;
+
+		static constexpr adhd::PageBacking pages = adhd::PageBacking::SMALL;
+
+		// one index per node: nodes are packed, as in a plain index array
+		static constexpr size_t node_size = sizeof(uint64_t);
+		static constexpr size_t node_size_max = 1 << 12;
+		static constexpr size_t payload = 0;
+
+		// what every hop does with the payload, see adhd::kernels::Access
+		static constexpr adhd::kernels::Access access = adhd::kernels::Access::READ;
 
 		static constexpr uint_fast32_t MiB = 1 << 8;
+
+		// repeat every point until its median is known precisely enough (see
+		// adhd::statistics::Repetition), reporting a summary row instead of a row
+		// per walk
+		static constexpr bool repeat = false;
+
+		// memory hierarchy sweep: from well within the first level cache to well
+		// beyond the last level cache, a cache line per node; a coarse grid that
+		// is refined around the latency knees
+		static constexpr size_t hierarchy_size_min = 1 << 12;
+		static constexpr size_t hierarchy_size_max = size_t(1) << 30;
+		static constexpr unsigned hierarchy_size_mul = 4;
+		static constexpr double hierarchy_threshold = 0.2;
+		static constexpr double hierarchy_resolution = 0.1;
+		static constexpr size_t hierarchy_node_size = 64;
+		static constexpr uint_fast32_t hierarchy_MiB = 1 << 4;
 	}
 
 	struct Config {
@@ -37,16 +81,36 @@ namespace arraywalk {
 				unsigned _istream_max = defaults::istream_max,
 				size_t _align         = defaults::align,
 				pattern _ptrn         = defaults::ptrn,
-				uint_fast32_t _MiB    = defaults::MiB);
+				uint_fast32_t _MiB    = defaults::MiB,
+				adhd::PageBacking _pages = defaults::pages,
+				size_t _node_size     = defaults::node_size,
+				size_t _payload       = defaults::payload,
+				double _size_threshold  = defaults::size_threshold,
+				double _size_resolution = defaults::size_resolution,
+				double _size_budget     = defaults::size_budget,
+				adhd::kernels::Access _access = defaults::access,
+				bool _repeat          = defaults::repeat);
 
 		size_t size_min;
 		size_t size_max;
 		unsigned size_mul;
 		size_t size_inc;
+		double size_threshold;
+		double size_resolution;
+		double size_budget;
 		unsigned istream_min;
 		unsigned istream_max;
 		uintptr_t align;
 		pattern ptrn;
 		uint_fast32_t MiB;
+		adhd::PageBacking pages;
+		// Every hop of a walk visits one node of node_size bytes (a power of two,
+		// between the index size and defaults::node_size_max), reading the index
+		// at its start and the payload bytes following it. Node sizes of a cache
+		// line or a page make each hop touch exactly one line resp. page.
+		size_t node_size;
+		size_t payload;
+		adhd::kernels::Access access;
+		bool repeat;
 	};
 }
@@ -8,6 +8,8 @@
 
 #include "arraywalk.hpp"
 #include "../benchmark.hpp"
+#include "../hierarchy.hpp"
+#include "../timers.hpp"
 #include "timings.hpp"
 
 using namespace std;
@@ -26,7 +28,80 @@ static void run_test(ofstream & logfile, unsigned trial) {
 	catch (const length_error &) { /* deliberately ignored */ }
 }
 
+// memory hierarchy report: fit the latency curve of a random walk size sweep
+static int run_hierarchy(const string & filename) {
+	ofstream logfile(filename);
+	if (!logfile) {
+		cerr << "failed to open CSV output file \"" << filename << "\"" << endl;
+		return -1;
+	}
+
+	Config cfg;
+	cfg.size_min = defaults::hierarchy_size_min;
+	cfg.size_max = defaults::hierarchy_size_max;
+	cfg.size_mul = defaults::hierarchy_size_mul;
+	cfg.size_inc = 0;
+	cfg.size_threshold = defaults::hierarchy_threshold;
+	cfg.size_resolution = defaults::hierarchy_resolution;
+	cfg.istream_min = cfg.istream_max = 1;
+	cfg.ptrn = RANDOM;
+	cfg.MiB = defaults::hierarchy_MiB;
+	cfg.pages = adhd::PageBacking::TRANSPARENT;
+	cfg.node_size = defaults::hierarchy_node_size;
+	adhd::HierarchyFit fit;
+	bool wroteHeader = false;
+	ArrayWalk<uint64_t>(cfg).run(
+			[&logfile, &wroteHeader, &fit] (const adhd::Timings & timings) {
+			if (!wroteHeader) {
+				timings.formatHeader(logfile);
+				wroteHeader = true;
+			}
+			// a single trial
+			logfile << 1 << "," << timings.asCSV();
+			cout << timings.asHuman() << endl;
+			const TimingData & td = dynamic_cast<const Timings &>(timings).data();
+			fit.add(td.length * td.idx_size, (double) td.cycles / (double) td.reads);
+			});
+	fit.report(cout);
+	return 0;
+}
+
+// repeat every point of the default sweep until its median is known to within
+// the default confidence interval width, logging a summary row per point
+static int run_adaptive(const string & filename) {
+	ofstream logfile(filename);
+	if (!logfile) {
+		cerr << "failed to open CSV output file \"" << filename << "\"" << endl;
+		return -1;
+	}
+
+	Config cfg;
+	cfg.repeat = true;
+	bool wroteHeader = false;
+	ArrayWalk<uint64_t>(cfg).run(
+			[&logfile, &wroteHeader] (const adhd::Timings & timings) {
+			if (!wroteHeader) {
+				timings.formatHeader(logfile);
+				wroteHeader = true;
+			}
+			// a single trial
+			logfile << 1 << "," << timings.asCSV();
+			cout << timings.asHuman() << endl;
+			});
+	return 0;
+}
+
 int main(int argc, char * argv[]) {
+	// calibrates the TSC before any measurement
+	adhd::timers::describe(cerr) << endl;
+
+	// "hierarchy" as first argument reports the memory hierarchy instead, with
+	// an optional second argument determining the csv log filename
+	if (argc > 1 && string(argv[1]) == "hierarchy")
+		return run_hierarchy(argc > 2 ? argv[2] : "hierarchy.log");
+	// likewise for "adaptive", repeating every point until its median converges
+	if (argc > 1 && string(argv[1]) == "adaptive")
+		return run_adaptive(argc > 2 ? argv[2] : "adaptive.log");
 
 	unsigned trials = 1;
 	string filename = "arraywalk.log";
@@ -1,6 +1,7 @@
 #include "timings.hpp"
 
 #include "../prettyprint.hpp"
+#include "../timers.hpp"
 
 #include <iostream>
 
@@ -23,23 +24,33 @@ namespace arraywalk {
 		td(_td)
 	{}
 
+	Timings * Timings::clone() const { return new Timings(*this); }
+
 	ostream & Timings::formatHeader(ostream & out) const {
-		out << "thread#, cycles, reads, elements, element size, instruction streams" << endl;
+		out << "thread#, ticks, ns, reads, pattern, access, elements, element size, node size, payload, "
+			"instruction streams, pages, setup ticks" << endl;
 		return out;
 	}
 
 	ostream & Timings::formatCSV(ostream & out) const {
-		return sequence(out, td.cycles, td.reads, td.length, td.idx_size, td.istreams);
+		return sequence(out, td.cycles, adhd::timers::Default::ns(td.cycles), td.reads, td.ptrn, td.access, td.length, td.idx_size,
+				td.node_size, td.payload, td.istreams, td.pages, td.setupCycles);
 	}
 
 	ostream & Timings::formatHuman(ostream & out) const {
-		out << td.length << " elements x " << Bytes(td.idx_size) << " = "
-			<< Bytes(td.length * td.idx_size) << " | " << td.istreams
-			<< " instruction streams" << endl;
-		out << "cycles: " << td.cycles << " | ";
-		out << "reads: " << td.reads << " (" << Bytes(td.reads * td.idx_size) << ")" << endl;
-		out << "~cycles per read: "
-			<< (double) td.cycles / (double) td.reads << endl;
+		out << td.ptrn << " " << td.access << " | " << td.length << " elements x " << Bytes(td.idx_size) << " = "
+			<< Bytes(td.length * td.idx_size) << " | "
+			<< td.length * td.idx_size / td.node_size << " nodes x " << Bytes(td.node_size)
+			<< " (" << Bytes(td.payload) << " payload)"
+			<< " | " << td.pages << " pages"
+			<< " | " << td.istreams << " instruction streams" << endl;
+		out << "setup ticks: " << td.setupCycles << endl;
+		out << "ticks: " << td.cycles << " (" << adhd::timers::Default::ns(td.cycles) << " ns) | ";
+		out << "reads: " << td.reads << " ("
+			<< Bytes(td.reads * (td.idx_size + td.payload)) << ")" << endl;
+		out << "~ticks per read: "
+			<< (double) td.cycles / (double) td.reads
+			<< " (" << adhd::timers::Default::ns(td.cycles) / (double) td.reads << " ns)" << endl;
 		return out;
 	}
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../benchmark.hpp"
+#include "../memory.hpp"
+#include "config.hpp"
 
 #include <cstddef>
 #include <cstdint>
@@ -9,21 +11,31 @@
 namespace arraywalk {
 
 	struct TimingData {
+		// timer ticks (see adhd::timers), not core cycles
 		uint64_t cycles;
 		uint64_t reads;
+		pattern ptrn;
+		adhd::kernels::Access access;
 		size_t length;
 		size_t idx_size;
+		size_t node_size;
+		size_t payload;
 		unsigned istreams;
+		adhd::PageBacking pages;
+		uint64_t setupCycles;
 	};
 	static_assert(std::is_pod<TimingData>::value, "struct TimingData must be a POD");
 
 	class Timings: public adhd::Timings {
 		public:
 			Timings(const TimingData & td);
+			virtual Timings * clone() const override;
 			virtual std::ostream & formatHeader(std::ostream & out) const override;
 			virtual std::ostream & formatCSV(std::ostream & out) const override;
 			virtual std::ostream & formatHuman(std::ostream & out) const override;
 
+			inline const TimingData & data() const { return td; }
+
 		private:
 			TimingData td;
 	};
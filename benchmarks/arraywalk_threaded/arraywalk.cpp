@@ -1,14 +1,20 @@
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <exception>
 #include <iostream>
 #include <random>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 
 #include "arraywalk.hpp"
 #include "../benchmark.hpp"
-#include "../rdtsc.h"
+#include "../cycle.hpp"
+#include "../kernels.hpp"
+#include "../memory.hpp"
+#include "../timers.hpp"
 #include "timings.hpp"
 #include "util.hpp"
 
@@ -33,28 +39,78 @@ namespace arraywalk {
 	static const char NOT_POW2_ALIGN[] =
 		"Requested memory alignment for the walking array is not a power of two.";
 
+	// Nodes must hold at least an index, and may span at most a (small) page.
+	static const char NODE_SIZE_RANGE[] =
+		"Requested node size is not a power of two between the index size and 4 KiB.";
+
+	// The payload is stored in the node, after its index.
+	static const char PAYLOAD_TOO_LARGE[] =
+		"Requested payload does not fit in a node next to the index.";
+
+	// The maximum stride pattern alternates between both halves of the array.
+	static const char NEED_EVEN_NODES[] =
+		"Maximum stride pattern requires an even number of nodes.";
+
+	// Updating accesses store to the payload, never to the links.
+	static const char NEED_PAYLOAD[] =
+		"Updating accesses require a payload to update.";
+
+	// The prefetching kernels only read.
+	static const char PREFETCH_READ_ONLY[] =
+		"Prefetching walks only support read accesses.";
+	static const char SAMPLING_READ_ONLY[] =
+		"Per-hop latency sampling only supports read accesses.";
+
 	// Default-constructed class does not have an array to walk, and walking it
 	// is therefore impossible.
 	static const char NOT_INITIALIZED[] =
 		"Default-constructed walking array was not initialized.";
 
+	// Threads are only placed on allowed cpus.
+	static const char NO_CPUS_ON_NODE[] =
+		"Requested cpu node has no cpus the threads are allowed to run on.";
+
+	// keep the hogs' streaming reads from being optimized away
+	static volatile uint64_t hogSink;
+
 	template <typename INDEX_T>
 	ArrayWalk<INDEX_T>::ArrayWalk(const Config & cfg):
-		ThreadedBenchmark(cfg.threads_min, cfg.threads_max),
+		ThreadedBenchmark(cfg.threads_min, cfg.threads_max, cfg.affinity),
 		Config(cfg),
 		length(0),
-		arraymem(NULL),
-		array(NULL)
-	{}
+		nodes(0),
+		stride(1),
+		words(0),
+		spread(1),
+		lanes(1),
+		arraymem(),
+		array(NULL),
+		memNode(-1),
+		privmem(new Arena[cfg.threads_max]),
+		walkArrays(cfg.threads_max, NULL),
+		walkNodes(cfg.threads_max, -1),
+		cycle(),
+		shadow(),
+		shadowPos(),
+		hogmem(new Arena[cfg.threads_max]),
+		hogBytes(cfg.threads_max, 0),
+		hogSeconds(cfg.threads_max, 0),
+		hogStop(false),
+		hopSamples(cfg.threads_max),
+		setupStart(0),
+		setupCycles(0)
+	{
+		countEvents(adhd::metrics::events(cfg.metrics, cfg.events), cfg.scheduling);
+		sampleEvents(chrono::nanoseconds(cfg.series_period), cfg.series_samples);
+	}
 
 	template <typename INDEX_T>
 	ArrayWalk<INDEX_T>::~ArrayWalk()
-	{
-		delete[] arraymem;
-	}
+	{}
 
 	template <typename INDEX_T>
 		void ArrayWalk<INDEX_T>::init(unsigned /*threadNum*/) {
+			setupStart = timers::Default::now();
 			length = Config::currentSize() / sizeof(INDEX_T);
 
 			/* icpc warns about implicit conversion, which is rather odd when doing
@@ -79,37 +135,166 @@ namespace arraywalk {
 			if (rep_length != length)
 				throw length_error(NOT_INDEXABLE);
 
-			if (length < 4)
+			if (Config::node_size < sizeof(INDEX_T)
+					|| Config::node_size > defaults::node_size_max
+					|| !util::isPowerOfTwo<size_t>(Config::node_size))
+				throw domain_error(NODE_SIZE_RANGE);
+
+			if (Config::payload > Config::node_size - sizeof(INDEX_T))
+				throw domain_error(PAYLOAD_TOO_LARGE);
+
+			stride = Config::node_size / sizeof(INDEX_T);
+			words = (Config::payload + sizeof(INDEX_T) - 1) / sizeof(INDEX_T);
+			nodes = length / stride;
+
+			if (kernels::Access::READ != Config::currentAccess()) {
+				if (0 == words)
+					throw domain_error(NEED_PAYLOAD);
+				if (Config::currentDistance() > 0)
+					throw domain_error(PREFETCH_READ_ONLY);
+				if (Config::sample_every > 0)
+					throw domain_error(SAMPLING_READ_ONLY);
+			}
+
+			if (nodes < 4)
 				throw length_error(NEED_FOUR_ELEMENTS);
 
 			if (!util::isPowerOfTwo<size_t>(align))
 				throw domain_error(NOT_POW2_ALIGN);
 
-			// allocate with overhead to cater for later alignment
-			// arraymem must be NULL or previously allocated by this function
-			const size_t overhead = 1 + align / sizeof(INDEX_T);
-			delete[] arraymem;
-			arraymem = new INDEX_T[length + overhead];
-			const uintptr_t aligned =
-				(reinterpret_cast<uintptr_t>(arraymem) + align) & (~(align - 1));
-			array = reinterpret_cast<INDEX_T *>(aligned);
+			// the array at the start of the arena, using the requested page size,
+			// which may fall back to smaller pages: the obtained backing is
+			// reported in the timings
+			const size_t bytes = length * sizeof(INDEX_T);
+			arraymem.reserve(Config::maxSize(), Config::maxAlign(), Config::pages);
+			arraymem.reset();
+			array = static_cast<INDEX_T *>(arraymem.window(bytes, align, Config::pages));
+
+			// one node per page for RANDOM_PAGES, at an offset that shifts by one
+			// node every page; the page size is only known after mapping
+			spread = stride;
+			lanes = 1;
+			if (Pattern::RANDOM_PAGES == Config::ptrn) {
+				spread = pageSize(arraymem.backing()) / sizeof(INDEX_T);
+				lanes = spread / stride;
+				nodes = length / spread;
+				if (nodes < 4)
+					throw length_error(NEED_FOUR_ELEMENTS);
+			}
+
+			// apply the placement policy before the array is first touched; 'local'
+			// refers to the node walker thread 0 is going to run on
+			switch (Config::placement) {
+				case numa::Placement::LOCAL:
+					memNode = cpu_node >= 0 ?
+						cpu_node : static_cast<int>(numa::cpuNode(threadCpu(0)));
+					break;
+				case numa::Placement::REMOTE:
+					memNode = static_cast<int>(mem_node);
+					break;
+				default:
+					memNode = -1;
+					break;
+			}
+			numa::bind(array, bytes, Config::placement, static_cast<unsigned>(memNode));
+			// bound pages are faulted in on their node right away (moved there when
+			// reused, see numa::bind), not while walking; first touch placement
+			// leaves faulting to the walker
+			const bool populate = numa::Placement::FIRST_TOUCH != Config::placement;
+			if (populate)
+				arraymem.populate(array, bytes);
+
+			// private copies are placed like the shared array, or bound to the node
+			// of their own thread; they are filled once the pattern is complete
+			const Sharing sharing = Config::currentSharing();
+			for (unsigned t = 0; t < numThreads(); ++t) {
+				if (Sharing::PRIVATE != sharing && Sharing::PRIVATE_LOCAL != sharing) {
+					privmem[t].release();
+					walkArrays[t] = array;
+					walkNodes[t] = memNode;
+					continue;
+				}
+				privmem[t].reserve(Config::maxSize(), Config::maxAlign(), Config::pages);
+				privmem[t].reset();
+				walkArrays[t] = static_cast<INDEX_T *>(
+						privmem[t].window(bytes, align, Config::pages));
+				if (Sharing::PRIVATE == sharing) {
+					walkNodes[t] = memNode;
+					numa::bind(walkArrays[t], bytes, Config::placement,
+							static_cast<unsigned>(memNode));
+					if (populate)
+						privmem[t].populate(walkArrays[t], bytes);
+				}
+				else {
+					walkNodes[t] = static_cast<int>(cpu_node >= 0 ?
+							static_cast<unsigned>(cpu_node) : numa::cpuNode(threadCpu(t)));
+					numa::bind(walkArrays[t], bytes, numa::Placement::LOCAL,
+							static_cast<unsigned>(walkNodes[t]));
+					privmem[t].populate(walkArrays[t], bytes);
+				}
+			}
+
+			hogStop = false;
+
+			// random patterns are generated by all threads in parallel, see ready();
+			// under first-touch placement their pages spread over the threads
+			if (Pattern::RANDOM == Config::ptrn)
+				cycle.reset(new CycleGenerator<INDEX_T>(array, nodes, stride, numThreads(),
+							defaults::seed));
+			else {
+				cycle.reset();
+				if (numa::Placement::FIRST_TOUCH != Config::placement)
+					initPattern();
+			}
+		}
 
+	template <typename INDEX_T>
+		void ArrayWalk<INDEX_T>::initPattern() {
 			switch (Config::ptrn) {
-				case Pattern::RANDOM: random(); break;
+				case Pattern::RANDOM: break; // see init()
 				case Pattern::INCREASING: increasing(); break;
 				case Pattern::INCREASING_MAXSTRIDE: increasing_maxstride(); break;
 				case Pattern::DECREASING: decreasing(); break;
+				case Pattern::RANDOM_IN_PAGE: randomInPage(); break;
+				case Pattern::RANDOM_PAGES: randomPages(); break;
 			}
-
-
 		}
 
 	template <typename INDEX_T>
-		void ArrayWalk<INDEX_T>::ready(unsigned /*threadNum*/) {
+		void ArrayWalk<INDEX_T>::ready(unsigned threadNum) {
+			// hogs fill their own buffer, so it is local to them
+			if (Traffic::NONE != Config::traffic && 0 != threadNum) {
+				hogmem[threadNum].reset();
+				uint64_t * const buf = static_cast<uint64_t *>(hogmem[threadNum].window(
+							Config::hog_size, pageSize(PageBacking::SMALL), Config::pages));
+				for (size_t w = 0; w < hogmem[threadNum].used() / sizeof(uint64_t); ++w)
+					buf[w] = w;
+			}
+
+			if (cycle)
+				cycle->generate(threadNum);
+			else if (0 == threadNum && numa::Placement::FIRST_TOUCH == Config::placement)
+				initPattern();
 		}
 
 	template <typename INDEX_T>
-		void ArrayWalk<INDEX_T>::set(unsigned /*threadNum*/) {
+		void ArrayWalk<INDEX_T>::set(unsigned threadNum) {
+			// all threads finished their part of the pattern in ready()
+			if (0 == threadNum) {
+				if (cycle)
+					cycle->stitch();
+				if (Config::currentDistance() > 0 || Sharing::OFFSET == Config::currentSharing())
+					buildShadow(Config::currentDistance());
+				else {
+					shadow.clear();
+					shadowPos.clear();
+				}
+				// private copies not made by their own thread are made by thread 0
+				if (Sharing::PRIVATE == Config::currentSharing())
+					for (unsigned t = 0; t < numThreads(); ++t)
+						copyArray(t);
+				setupCycles = timers::Default::now() - setupStart;
+			}
 		}
 
 	template <typename INDEX_T>
@@ -117,18 +302,92 @@ namespace arraywalk {
 	{
 		uint64_t cycles;
 		uint64_t reads;
+		// in loaded latency mode, all threads but the walker inject traffic
+		const bool loaded = Traffic::NONE != Config::traffic;
+		if (loaded && 0 != threadNum) {
+			hog(threadNum);
+			go_wait_end();
+			return;
+		}
+
+		if (Sharing::PRIVATE_LOCAL == Config::currentSharing())
+			copyArray(threadNum);
+		if (Config::sample_every > 0)
+			hopSamples[threadNum].resize(Config::readMiB * ((1 << 20) / sizeof(INDEX_T))
+					/ Config::sample_every);
+
+		uint64_t baseCycles;
 		const unsigned istream = Config::currentIStream();
+		const unsigned distance = Config::currentDistance();
+		const unsigned cpu = topology::currentCpu();
+		const unsigned cpuNode = numa::cpuNode(cpu);
+		auto walk = [&] (uint64_t & c) {
+			if (distance > 0)
+				timedwalk_pf(threadNum, istream, distance, Config::readMiB, c, reads);
+			else
+				timedwalk_loc(threadNum, istream, Config::readMiB, c, reads);
+		};
 		// warmup
-		timedwalk_loc(istream, Config::readMiB, cycles, reads);
+		walk(cycles);
 
-		// benchmark proper
+		// benchmark proper; under load, once more first to let the hogs ramp up
 		go_wait_start();
-		timedwalk_loc(istream, Config::readMiB, cycles, reads);
-		go_wait_end();
-		timing_callback(Timings(TimingData {
+		if (loaded)
+			walk(cycles);
+		startCounting(threadNum);
+		walk(cycles);
+		stopCounting(threadNum);
+		if (!loaded)
+			go_wait_end();
+		Config::recordSize((double) cycles / (double) reads);
+
+		// the plain chase under the same conditions, to compare prefetching with
+		baseCycles = cycles;
+		if (distance > 0) {
+			timedwalk_loc(threadNum, istream, Config::readMiB, baseCycles, reads);
+			if (!loaded)
+				go_wait_end();
+		}
+
+		// per-hop latencies of the plain chase, again under the same conditions;
+		// the timer overhead is taken out when folding them into the histogram
+		Histogram hops;
+		if (Config::sample_every > 0) {
+			uint64_t sampledCycles;
+			timedwalk_sampled(threadNum, istream, Config::readMiB, sampledCycles, reads);
+			if (!loaded)
+				go_wait_end();
+			const uint64_t overhead = timers::overhead();
+			for (const uint64_t s: hopSamples[threadNum])
+				hops.add(s > overhead ? s - overhead : 0);
+		}
+
+		// the hogs ran concurrently: their bandwidths add up
+		uint64_t injected = 0;
+		double seconds = 0;
+		if (loaded) {
+			hogStop = true;
+			go_wait_end();
+			for (unsigned t = 1; t < numThreads(); ++t) {
+				injected += hogBytes[t];
+				seconds = max(seconds, hogSeconds[t]);
+			}
+		}
+
+		timing_callback(threadNum, Timings(TimingData {
 					numThreads(), threadNum,
-					cycles, reads, length, sizeof(INDEX_T), istream, currentAlign()
-					}));
+					cycles, reads, Config::ptrn, Config::currentAccess(), length,
+					sizeof(INDEX_T), Config::node_size, Config::payload, istream,
+					Config::currentSharing(), Config::prefetch, distance, baseCycles,
+					Config::sample_every, hops.count(), hops.quantile(0.5), hops.quantile(0.9),
+					hops.quantile(0.99), hops.quantile(0.999), hops.max(), Config::traffic,
+					Config::currentHogDelay(), loaded ? numThreads() - 1 : 0, injected, seconds,
+					currentAlign(), arraymem.backing(),
+					Config::placement, walkNodes[threadNum], Config::affinity, cpu, cpuNode,
+					setupCycles
+					}, eventCounts(threadNum),
+					DerivedMetrics(Config::metrics, eventCounts(threadNum), reads,
+						timers::Default::ns(cycles), Config::peak_bandwidth)));
 	}
 
 	template <typename INDEX_T>
@@ -140,6 +399,34 @@ namespace arraywalk {
 			return new ArrayWalk<INDEX_T>(static_cast<const Config &>(*this));
 		}
 
+	// the cpus of cpu_node (if any) in the order of the affinity policy, so that
+	// every thread stays pinned to a single cpu
+	template <typename INDEX_T>
+		vector<unsigned> ArrayWalk<INDEX_T>::poolCpus() const {
+			const vector<unsigned> order = ThreadedBenchmark::poolCpus();
+			if (cpu_node < 0)
+				return order;
+			const vector<unsigned> local = numa::nodeCpus(static_cast<unsigned>(cpu_node));
+			vector<unsigned> cpus;
+			for (const auto cpu: order)
+				if (find(local.begin(), local.end(), cpu) != local.end())
+					cpus.push_back(cpu);
+			if (cpus.empty())
+				throw domain_error(NO_CPUS_ON_NODE);
+			return cpus;
+		}
+
+	// sized like the counts and metrics a thread reports, with room for the
+	// samples of the counts
+	template <typename INDEX_T>
+		adhd::Timings * ArrayWalk<INDEX_T>::makeRecord(unsigned threadNum) const {
+			EventCounts ec = eventCounts(threadNum);
+			ec.samples.reserve(eventCounts(threadNum).samples.capacity());
+			ec.deltas.reserve(eventCounts(threadNum).deltas.capacity());
+			const DerivedMetrics dm(Config::metrics, ec, 0, 0);
+			return new Timings(TimingData(), move(ec), dm);
+		}
+
 	template <typename INDEX_T>
 		void ArrayWalk<INDEX_T>::next() {
 			Config::next();
@@ -187,7 +474,7 @@ namespace arraywalk {
 	__uint128_t ArrayWalk<__uint128_t>::randomIndex(__uint128_t minimum)
 	{
 		const uint64_t min = static_cast<uint64_t>(minimum);
-		const uint64_t max = static_cast<uint64_t>(length - 1);
+		const uint64_t max = static_cast<uint64_t>(nodes - 1);
 		uniform_int_distribution<uint64_t> dis(min, max);
 		return dis(rng);
 	}
@@ -201,7 +488,7 @@ namespace arraywalk {
 #pragma warning(push)
 #pragma warning(disable:1682)
 #endif
-		const INDEX_T maximum = static_cast<INDEX_T>(length - 1);
+		const INDEX_T maximum = static_cast<INDEX_T>(nodes - 1);
 #ifdef __INTEL_COMPILER
 #pragma warning(pop)
 #endif
@@ -210,85 +497,135 @@ namespace arraywalk {
 	}
 
 	template <typename INDEX_T>
-	void ArrayWalk<INDEX_T>::random()
+	void ArrayWalk<INDEX_T>::increasing()
 	{
-		if (0 == length)
-			return;
+		size_t node;
+		for (node = 0; node < nodes - 1; ++node)
+			link(node, node + 1);
+		link(node, 0);
+	}
 
-		// initialization step encodes index as values
-		for (INDEX_T idx = 0; idx < length; ++idx)
-			array[idx] = idx;
-
-		// shuffle the array
-		// idx goes up to the penultimate element because element at idx is
-		// swapped with an element at > idx
-		INDEX_T rnd;
-		INDEX_T swap;
-		for (INDEX_T idx = 0; idx < length - 1; ++idx) {
-			rnd = randomIndex(static_cast<INDEX_T>(idx + 1));
-			swap = array[idx];
-			array[idx] = array[rnd];
-			array[rnd] = swap;
-		}
+	// alternate between both halves of the array: 0, n/2, 1, n/2 + 1, ...
+	template <typename INDEX_T>
+	void ArrayWalk<INDEX_T>::increasing_maxstride()
+	{
+		const size_t half = nodes / 2;
+		size_t node;
+
+		if (nodes % 2)
+			throw length_error(NEED_EVEN_NODES);
+
+		for (node = 0; node < half; ++node)
+			link(node, node + half);
+		for (; node < nodes - 1; ++node)
+			link(node, 1 + node - half);
+		link(node, 0);
 	}
 
 	template <typename INDEX_T>
-	void ArrayWalk<INDEX_T>::increasing()
+	void ArrayWalk<INDEX_T>::decreasing()
 	{
-		INDEX_T idx;
-		for (idx = 0; idx < length - 1; ++idx)
-			array[idx] = static_cast<INDEX_T>(idx + 1);
-		array[idx] = 0;
+		link(0, nodes - 1);
+		for (size_t node = 1; node < nodes; ++node)
+			link(node, node - 1);
 	}
 
+	// random lines within a page: walks the pages sequentially
 	template <typename INDEX_T>
-	void ArrayWalk<INDEX_T>::increasing_maxstride()
+	void ArrayWalk<INDEX_T>::randomInPage()
 	{
-		const INDEX_T len = static_cast<INDEX_T>(length);
-		const INDEX_T halflen = len / 2;
-		INDEX_T idx;
-
-		if (len % 2)
-			throw length_error(NOT_INDEXABLE);
-
-		for (idx = 0; idx < halflen; ++idx)
-			array[idx] = idx / halflen;
-		for (; idx < len - 1; ++idx)
-			array[idx] = 1 + idx - halflen;
-		array[idx] = 0;
+		const size_t perPage = pageSize(arraymem.backing()) / Config::node_size;
+		blockCycle(nodes, perPage, defaults::seed,
+				[this] (size_t from, size_t to) { link(from, to); });
 	}
 
+	// random pages, one node per page: see the layout set up by init()
 	template <typename INDEX_T>
-	void ArrayWalk<INDEX_T>::decreasing()
+	void ArrayWalk<INDEX_T>::randomPages()
 	{
-		/* see disable:1682 above */
-#ifdef __INTEL_COMPILER
-#pragma warning(push)
-#pragma warning(disable:1682)
-#endif
-		const INDEX_T maximum = static_cast<INDEX_T>(length - 1);
-#ifdef __INTEL_COMPILER
-#pragma warning(pop)
-#endif
-		array[0] = maximum;
-		for (INDEX_T idx = 1; idx < length; ++idx)
-			array[idx] = static_cast<INDEX_T>(idx - 1);
+		randomCycle(nodes, defaults::seed,
+				[this] (size_t from, size_t to) { link(from, to); });
+	}
+
+	// the completed pattern, into the private array of a thread
+	template <typename INDEX_T>
+	void ArrayWalk<INDEX_T>::copyArray(unsigned threadNum)
+	{
+		copy(array, array + length, walkArrays[threadNum]);
+	}
+
+	// Streams through the hog buffer a cache line at a time until the walker is
+	// done, pausing for the configured number of TSC ticks after every line.
+	template <typename INDEX_T>
+	void ArrayWalk<INDEX_T>::hog(unsigned threadNum)
+	{
+		constexpr size_t lineWords = 64 / sizeof(uint64_t);
+		constexpr size_t chunkWords = 4096 / sizeof(uint64_t);
+		uint64_t * const buf = static_cast<uint64_t *>(hogmem[threadNum].data());
+		const size_t bufWords = hogmem[threadNum].used() / sizeof(uint64_t);
+		const uint64_t delay = Config::currentHogDelay();
+		// a written line moves twice, read for ownership and written back, be it
+		// plainly written or read-modify-written
+		const uint64_t lineBytes = (Traffic::READ == Config::traffic ? 1 : 2) * 64;
+		uint64_t lines = 0;
+		uint64_t sum = 0;
+
+		go_wait_start();
+		const auto start = chrono::steady_clock::now();
+		for (size_t chunk = 0; !hogStop.load(memory_order_relaxed); chunk += chunkWords) {
+			if (chunk + chunkWords > bufWords)
+				chunk = 0;
+			for (size_t line = chunk; line < chunk + chunkWords; line += lineWords) {
+				for (size_t w = line; w < line + lineWords; ++w)
+					switch (Config::traffic) {
+						case Traffic::READ: sum += buf[w]; break;
+						case Traffic::WRITE: buf[w] = lines; break;
+						default: ++buf[w]; break;
+					}
+				++lines;
+				if (delay)
+					for (const uint64_t until = rdtsc() + delay; rdtsc() < until; );
+			}
+		}
+		const auto stop = chrono::steady_clock::now();
+
+		hogSink = sum;
+		hogBytes[threadNum] = lines * lineBytes;
+		hogSeconds[threadNum] = chrono::duration<double>(stop - start).count();
+	}
+
+	// Follows the cycle from node 0 to record it in visiting order, and the
+	// position of every node on it: walking streams may start at any node, and
+	// offset threads a number of nodes further along the cycle (see startNode()).
+	template <typename INDEX_T>
+	void ArrayWalk<INDEX_T>::buildShadow(size_t distance)
+	{
+		shadow.resize(nodes + distance);
+		shadowPos.resize(nodes);
+
+		size_t idx = slot(0);
+		for (size_t i = 0; i < nodes; ++i, idx = static_cast<size_t>(array[idx])) {
+			shadow[i] = static_cast<INDEX_T>(idx);
+			shadowPos[idx / spread] = i;
+		}
+		for (size_t i = nodes; i < shadow.size(); ++i)
+			shadow[i] = shadow[i - nodes];
 	}
 
 	template <typename INDEX_T>
 	bool ArrayWalk<INDEX_T>::isFullCycle()
 	{
-		INDEX_T i, idx;
-		bool * visited = new bool[length];
+		size_t i, idx;
+		bool * visited = new bool[nodes];
 		bool allVisited = true;
 
-		for (idx = 0; idx < length; ++idx)
+		for (idx = 0; idx < nodes; ++idx)
 			visited[idx] = false;
 
-		for (i = 0, idx = 0; i < length; ++i, idx = array[idx])
-			visited[idx] = true;
+		for (i = 0, idx = 0; i < nodes; ++i, idx = static_cast<size_t>(array[idx]))
+			visited[idx / spread] = true;
 
-		for (idx = 0; idx < length; ++idx)
+		for (idx = 0; idx < nodes; ++idx)
 			if (!visited[idx]) {
 				allVisited = false;
 				break;
@@ -1,16 +1,19 @@
 #pragma once
 
 #include "../benchmark.hpp"
+#include "../cycle.hpp"
+#include "../histogram.hpp"
+#include "../memory.hpp"
 #include "config.hpp"
 #include "timings.hpp"
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <random>
-
-#define TIMEDWALK_LOC_DEC(NUM) \
-	INDEX_T timedwalk_loc##NUM(uint_fast32_t, uint64_t &, uint64_t &)
+#include <vector>
 
 namespace arraywalk {
 
@@ -38,45 +41,96 @@ namespace arraywalk {
 				bool operator==(const ArrayWalk &) const;
 				bool operator!=(const ArrayWalk &) const;
 
+			protected:
+				virtual adhd::Timings * makeRecord(unsigned threadNum) const final override;
+				virtual std::vector<unsigned> poolCpus() const final override;
+
 			private:
 				size_t length;
-				INDEX_T * arraymem;
+				// the array is walked in nodes of 'stride' indices, of which the first
+				// links to the next node and the following 'words' are payload
+				size_t nodes;
+				size_t stride;
+				size_t words;
+				// node n starts at array index n * spread + (n % lanes) * stride, see
+				// the RANDOM_PAGES pattern; nodes are contiguous when spread == stride
+				size_t spread;
+				size_t lanes;
+				// reserved for the largest size and alignment, reused by every point
+				adhd::Arena arraymem;
 				INDEX_T * array;
-
-				INDEX_T timedwalk_loc(unsigned locs, uint_fast32_t MiB,
+				// node the array was bound to, or -1 when not bound to a single node
+				int memNode;
+				// the array each thread walks, and the node it was bound to: the shared
+				// array, or private copies of it (see Sharing)
+				std::unique_ptr<adhd::Arena[]> privmem;
+				std::vector<INDEX_T *> walkArrays;
+				std::vector<int> walkNodes;
+				// random patterns are generated by all threads, see ready()
+				std::unique_ptr<adhd::CycleGenerator<INDEX_T>> cycle;
+				// the cycle in visiting order, followed by the first 'distance' nodes
+				// again, and the position of the first nodes on it: the prefetch
+				// addresses of the prefetching walks, see buildShadow()
+				std::vector<INDEX_T> shadow;
+				std::vector<size_t> shadowPos;
+				// loaded latency: buffers of the hog threads, the traffic they injected
+				// (indexed by thread number), and the signal to stop injecting
+				std::unique_ptr<adhd::Arena[]> hogmem;
+				std::vector<uint64_t> hogBytes;
+				std::vector<double> hogSeconds;
+				std::atomic_bool hogStop;
+				// per-hop latency: a sample buffer per thread, allocated before the
+				// timed region
+				std::vector<std::vector<uint64_t>> hopSamples;
+				// array allocation and pattern generation time
+				uint64_t setupStart;
+				uint64_t setupCycles;
+
+				void initPattern();
+
+				INDEX_T timedwalk_loc(unsigned threadNum, unsigned locs, uint_fast32_t MiB,
 						uint64_t & cycles, uint64_t & reads);
+				INDEX_T timedwalk_pf(unsigned threadNum, unsigned locs, size_t distance,
+						uint_fast32_t MiB, uint64_t & cycles, uint64_t & reads);
+				INDEX_T timedwalk_sampled(unsigned threadNum, unsigned locs,
+						uint_fast32_t MiB, uint64_t & cycles, uint64_t & reads);
 				INDEX_T timedwalk_vec(uint_fast32_t MiB,
 						uint64_t & cycles, uint64_t & reads);
 
-				void random();
+				void buildShadow(size_t distance);
+				void hog(unsigned threadNum);
+
 				void increasing();
 				void increasing_maxstride();
 				void decreasing();
+				void randomInPage();
+				void randomPages();
+
+				// node stream k of a thread starts at: node k, or with OFFSET sharing
+				// the node t / #threads of the cycle further along (see buildShadow()),
+				// so that the threads are spaced evenly whatever the pattern
+				inline size_t startNode(unsigned threadNum, unsigned k) const {
+					const size_t node = k % nodes;
+					if (Sharing::OFFSET != Config::currentSharing())
+						return node;
+					const size_t pos = (shadowPos[node] + threadNum * nodes / numThreads()) % nodes;
+					return static_cast<size_t>(shadow[pos]) / spread;
+				}
+
+				void copyArray(unsigned threadNum);
+
+				inline size_t slot(size_t node) const {
+					return node * spread + (node % lanes) * stride;
+				}
+
+				// point node 'from' to node 'to'
+				inline void link(size_t from, size_t to) {
+					array[slot(from)] = static_cast<INDEX_T>(slot(to));
+				}
 
 				bool isFullCycle();
 
 				std::default_random_engine rng;
 				INDEX_T randomIndex(INDEX_T minimum);
-
-				TIMEDWALK_LOC_DEC(1);
-				TIMEDWALK_LOC_DEC(2);
-				TIMEDWALK_LOC_DEC(3);
-				TIMEDWALK_LOC_DEC(4);
-				TIMEDWALK_LOC_DEC(5);
-				TIMEDWALK_LOC_DEC(6);
-				TIMEDWALK_LOC_DEC(7);
-				TIMEDWALK_LOC_DEC(8);
-				TIMEDWALK_LOC_DEC(9);
-				TIMEDWALK_LOC_DEC(10);
-				TIMEDWALK_LOC_DEC(11);
-				TIMEDWALK_LOC_DEC(12);
-				TIMEDWALK_LOC_DEC(13);
-				TIMEDWALK_LOC_DEC(14);
-				TIMEDWALK_LOC_DEC(15);
-				TIMEDWALK_LOC_DEC(16);
-				TIMEDWALK_LOC_DEC(17);
-				TIMEDWALK_LOC_DEC(18);
-				TIMEDWALK_LOC_DEC(19);
-				TIMEDWALK_LOC_DEC(20);
 		};
 }
@@ -2,24 +2,96 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <iostream>
 
 // TODO type conversions: bounds checking
 namespace arraywalk {
 	using namespace adhd;
+	using namespace std;
+
+	ostream & operator<<(ostream & os, const Pattern & p) {
+		const char * str;
+		switch (p) {
+			case Pattern::RANDOM: str = "random"; break;
+			case Pattern::INCREASING: str = "increasing"; break;
+			case Pattern::INCREASING_MAXSTRIDE: str = "increasing maxstride"; break;
+			case Pattern::DECREASING: str = "decreasing"; break;
+			case Pattern::RANDOM_IN_PAGE: str = "random in page"; break;
+			case Pattern::RANDOM_PAGES: str = "random pages"; break;
+			default: str = "<unknown>"; break;
+		}
+		return os << str;
+	}
+
+	ostream & operator<<(ostream & os, const Traffic & t) {
+		const char * str;
+		switch (t) {
+			case Traffic::NONE: str = "none"; break;
+			case Traffic::READ: str = "read"; break;
+			case Traffic::WRITE: str = "write"; break;
+			case Traffic::READ_WRITE: str = "read-write"; break;
+			default: str = "<unknown>"; break;
+		}
+		return os << str;
+	}
+
+	ostream & operator<<(ostream & os, const Sharing & s) {
+		const char * str;
+		switch (s) {
+			case Sharing::SAME_PATH: str = "same path"; break;
+			case Sharing::OFFSET: str = "offset"; break;
+			case Sharing::PRIVATE: str = "private"; break;
+			case Sharing::PRIVATE_LOCAL: str = "private local"; break;
+			default: str = "<unknown>"; break;
+		}
+		return os << str;
+	}
 
 	Config::Config( unsigned _threads_min, unsigned _threads_max,
 			size_t _size_min, size_t _size_max, unsigned _size_mul,
 			size_t _size_inc, unsigned _istream_min, unsigned _istream_max,
 			uintptr_t _align_min, uintptr_t _align_max, uintptr_t _align_mul,
-			uintptr_t _align_inc, Pattern _ptrn, uint_fast32_t _MiB):
+			uintptr_t _align_inc, Pattern _ptrn, uint_fast32_t _MiB,
+			PageBacking _pages, numa::Placement _placement, unsigned _mem_node,
+			int _cpu_node, size_t _node_size, size_t _payload, double _size_threshold,
+			double _size_resolution, double _size_budget, unsigned _distance_min,
+			unsigned _distance_max, unsigned _distance_mul, unsigned _distance_inc,
+			kernels::Prefetch _prefetch, initializer_list<kernels::Access> _access,
+			Traffic _traffic, initializer_list<uint64_t> _hog_delays, size_t _hog_size,
+			initializer_list<Sharing> _sharing, unsigned _sample_every,
+			topology::Affinity _affinity, const vector<hwcounters::enum_t> & _events,
+			Scheduling _scheduling, uint64_t _series_period, size_t _series_samples,
+			const vector<Metric> & _metrics, double _peak_bandwidth):
 		RangeSet(
-				CAS_arraysize(_size_min, _size_max, _size_mul, _size_inc),
+				CAS_arraysize(_size_min, _size_max, _size_mul, _size_inc, _size_threshold,
+					_size_resolution, _size_budget, defaults::size_granule),
 				CAS_istreams(_istream_min, _istream_max),
-				CAS_alignment(_align_min, _align_max, _align_mul, _align_inc)),
+				CAS_alignment(_align_min, _align_max, _align_mul, _align_inc),
+				CAS_distance(_distance_min, _distance_max, _distance_mul, _distance_inc),
+				CAS_access(_access),
+				CAS_delay(_hog_delays),
+				CAS_sharing(_sharing)),
 		threads_min(_threads_min),
 		threads_max(_threads_max),
 		ptrn(_ptrn),
-		readMiB(_MiB)
+		readMiB(_MiB),
+		pages(_pages),
+		placement(_placement),
+		mem_node(_mem_node),
+		cpu_node(_cpu_node),
+		node_size(_node_size),
+		payload(_payload),
+		prefetch(_prefetch),
+		traffic(_traffic),
+		hog_size(_hog_size),
+		sample_every(_sample_every),
+		affinity(_affinity),
+		events(_events),
+		scheduling(_scheduling),
+		series_period(_series_period),
+		series_samples(_series_samples),
+		metrics(_metrics),
+		peak_bandwidth(_peak_bandwidth)
 	{
 		// TODO: argument validity checks
 	}
@@ -1,21 +1,64 @@
 #pragma once
 
 #include "../benchmark.hpp"
+#include "../eventcounts.hpp"
+#include "../kernels.hpp"
+#include "../memory.hpp"
+#include "../metrics.hpp"
+#include "../numa.hpp"
+#include "../topology.hpp"
 
 // TODO libconfig as backend
 
 #include <cstddef>
 #include <cstdint>
-
+#include <initializer_list>
 #include <iostream>
+#include <vector>
 
 namespace arraywalk {
 
-	enum class Pattern { RANDOM, INCREASING, INCREASING_MAXSTRIDE, DECREASING };
+	// Access patterns; besides the plain random and sequential walks:
+	// RANDOM_IN_PAGE - random order over the nodes inside a page, pages walked
+	//                  sequentially: cache misses with few TLB misses
+	// RANDOM_PAGES   - random order over pages, touching a single node per page
+	//                  (staggered over pages to avoid cache set conflicts):
+	//                  a TLB miss on every hop once the pages exceed the TLB reach
+	enum class Pattern {
+		RANDOM, INCREASING, INCREASING_MAXSTRIDE, DECREASING, RANDOM_IN_PAGE, RANDOM_PAGES
+	};
+
+	std::ostream & operator<<(std::ostream & os, const Pattern & p);
+
+	// Loaded latency: when not NONE, only thread 0 walks, while all other
+	// threads stream through buffers of their own (reading, writing, or
+	// incrementing every word), pausing a given number of TSC ticks (rdtsc, not
+	// core cycles) after every cache line to throttle the bandwidth they inject.
+	enum class Traffic { NONE, READ, WRITE, READ_WRITE };
+
+	std::ostream & operator<<(std::ostream & os, const Traffic & t);
+
+	// What the walker threads share:
+	// SAME_PATH     - one array, every thread starting at the same nodes: the
+	//                 threads chase the same lines in near-lockstep
+	// OFFSET        - one array, thread t starting t / #threads of the cycle
+	//                 further along: the threads chase distinct lines of one
+	//                 cycle, evenly spaced
+	// PRIVATE       - a copy of the array per thread, all made and placed like
+	//                 the shared array (i.e. on a single node)
+	// PRIVATE_LOCAL - a copy of the array per thread, first touched by and
+	//                 bound to the node of its own thread
+	enum class Sharing { SAME_PATH, OFFSET, PRIVATE, PRIVATE_LOCAL };
+
+	std::ostream & operator<<(std::ostream & os, const Sharing & s);
 
-	using CAS_arraysize = adhd::AffineStepper<size_t>;
+	using CAS_arraysize = adhd::AdaptiveStepper<size_t>;
 	using CAS_istreams = adhd::AffineStepper<unsigned>;
 	using CAS_alignment = adhd::AffineStepper<uintptr_t>;
+	using CAS_distance = adhd::AffineStepper<unsigned>;
+	using CAS_access = adhd::ExplicitStepper<adhd::kernels::Access>;
+	using CAS_delay = adhd::ExplicitStepper<uint64_t>;
+	using CAS_sharing = adhd::ExplicitStepper<Sharing>;
 
 	namespace defaults {
 		static constexpr unsigned threads_min = 1;
@@ -25,6 +68,12 @@ namespace arraywalk {
 		static constexpr size_t size_max = 1 << 14;
 		static constexpr size_t size_mul = 1;
 		static constexpr size_t size_inc = 1 << 12;
+		// adaptive refinement of the size sweep, see AdaptiveStepper: disabled by
+		// default
+		static constexpr double size_threshold = 0;
+		static constexpr double size_resolution = 0.05;
+		static constexpr double size_budget = 0;
+		static constexpr size_t size_granule = 1 << 12;
 
 		static constexpr unsigned istream_min = 1;
 		static constexpr unsigned istream_max = 5;
@@ -35,11 +84,75 @@ namespace arraywalk {
 		static constexpr uintptr_t align_inc = 0;
 
 		static constexpr Pattern ptrn = Pattern::RANDOM;
+		static constexpr uint64_t seed = 0x5eed;
+
+		static constexpr adhd::PageBacking pages = adhd::PageBacking::SMALL;
+
+		static constexpr adhd::numa::Placement placement = adhd::numa::Placement::FIRST_TOUCH;
+		static constexpr unsigned mem_node = 0;
+		static constexpr int cpu_node = -1;
+
+		// one index per node: nodes are packed, as in a plain index array
+		static constexpr size_t node_size = sizeof(uint64_t);
+		static constexpr size_t node_size_max = 1 << 12;
+		static constexpr size_t payload = 0;
+
+		// software prefetch distance in hops; 0 only measures the plain chase
+		static constexpr unsigned distance_min = 0;
+		static constexpr unsigned distance_max = 0;
+		static constexpr unsigned distance_mul = 1;
+		static constexpr unsigned distance_inc = 1;
+		static constexpr adhd::kernels::Prefetch prefetch = adhd::kernels::Prefetch::T0;
+
+		// what every hop does with the payload, see adhd::kernels::Access
+		static constexpr adhd::kernels::Access access = adhd::kernels::Access::READ;
+
+		// loaded latency, disabled by default; per hog thread buffers should be
+		// well beyond the last level cache
+		static constexpr Traffic traffic = Traffic::NONE;
+		static constexpr uint64_t hog_delay = 0;
+		static constexpr size_t hog_size = size_t(1) << 26;
+
+		static constexpr Sharing sharing = Sharing::SAME_PATH;
+
+		// per-hop latency histogram: time every sample_every-th hop of an extra
+		// walk, 0 disables sampling
+		static constexpr unsigned sample_every = 0;
+
+		static constexpr adhd::topology::Affinity affinity = adhd::topology::Affinity::COMPACT;
+
+		// hardware events beyond the counters: exact counts over several runs
+		static constexpr adhd::Scheduling scheduling = adhd::Scheduling::PASSES;
+
+		// time series of the counted events: sample them every series_period ns
+		// of the timed walk, keeping the last series_samples of every thread; a
+		// zero period disables sampling
+		static constexpr uint64_t series_period = 0;
+		static constexpr size_t series_samples = 1 << 12;
+
+		// the DRAM bandwidth (GB/s) a walking thread can draw at most, which its
+		// derived bandwidth is held against (see adhd::DerivedMetrics); 0 when
+		// unknown, never diagnosing a walk bandwidth-bound
+		static constexpr double peak_bandwidth = 0;
+
+		// loaded latency curve: a single walker chasing random cache lines well
+		// beyond the last level cache, and all other cpus injecting traffic
+		static constexpr size_t loaded_size = size_t(1) << 28;
+		static constexpr size_t loaded_node_size = 64;
+		static constexpr uint_fast32_t loaded_MiB = 1 << 4;
+
+		// counter profile: a single walker chasing random cache lines well beyond
+		// the last level cache for some ten seconds, sampled every 10 ms
+		static constexpr size_t profile_size = size_t(1) << 28;
+		static constexpr size_t profile_node_size = 64;
+		static constexpr uint_fast32_t profile_MiB = 1 << 10;
+		static constexpr uint64_t profile_period = 10 * 1000 * 1000;
 
 		static constexpr uint_fast32_t MiB = 1 << 8;
 	}
 
-	struct Config: public adhd::RangeSet<CAS_arraysize, CAS_istreams, CAS_alignment> {
+	struct Config: public adhd::RangeSet<CAS_arraysize, CAS_istreams, CAS_alignment,
+		CAS_distance, CAS_access, CAS_delay, CAS_sharing> {
 
 		Config(
 				unsigned _threads_min = defaults::threads_min,
@@ -55,11 +168,43 @@ namespace arraywalk {
 				uintptr_t _align_mul  = defaults::align_mul,
 				uintptr_t _align_inc  = defaults::align_inc,
 				Pattern _ptrn         = defaults::ptrn,
-				uint_fast32_t _MiB    = defaults::MiB);
+				uint_fast32_t _MiB    = defaults::MiB,
+				adhd::PageBacking _pages = defaults::pages,
+				adhd::numa::Placement _placement = defaults::placement,
+				unsigned _mem_node    = defaults::mem_node,
+				int _cpu_node         = defaults::cpu_node,
+				size_t _node_size     = defaults::node_size,
+				size_t _payload       = defaults::payload,
+				double _size_threshold  = defaults::size_threshold,
+				double _size_resolution = defaults::size_resolution,
+				double _size_budget     = defaults::size_budget,
+				unsigned _distance_min  = defaults::distance_min,
+				unsigned _distance_max  = defaults::distance_max,
+				unsigned _distance_mul  = defaults::distance_mul,
+				unsigned _distance_inc  = defaults::distance_inc,
+				adhd::kernels::Prefetch _prefetch = defaults::prefetch,
+				std::initializer_list<adhd::kernels::Access> _access = { defaults::access },
+				Traffic _traffic      = defaults::traffic,
+				std::initializer_list<uint64_t> _hog_delays = { defaults::hog_delay },
+				size_t _hog_size      = defaults::hog_size,
+				std::initializer_list<Sharing> _sharing = { defaults::sharing },
+				unsigned _sample_every = defaults::sample_every,
+				adhd::topology::Affinity _affinity = defaults::affinity,
+				const std::vector<adhd::hwcounters::enum_t> & _events =
+					std::vector<adhd::hwcounters::enum_t>(),
+				adhd::Scheduling _scheduling = defaults::scheduling,
+				uint64_t _series_period = defaults::series_period,
+				size_t _series_samples = defaults::series_samples,
+				const std::vector<adhd::Metric> & _metrics = std::vector<adhd::Metric>(),
+				double _peak_bandwidth = defaults::peak_bandwidth);
 
 		size_t inline minSize() const { return getMinValue<0>(); }
 		size_t inline maxSize() const { return getMaxValue<0>(); }
 		size_t inline currentSize() const { return getValue<0>(); }
+		// feed back the latency measured at the current size
+		void inline recordSize(double latency) const {
+			get<0>().record(currentSize(), latency);
+		}
 
 		unsigned inline minIStream() const { return getMinValue<1>(); }
 		unsigned inline maxIStream() const { return getMaxValue<1>(); }
@@ -69,9 +214,66 @@ namespace arraywalk {
 		uintptr_t inline maxAlign() const { return getMaxValue<2>(); }
 		uintptr_t inline currentAlign() const { return getValue<2>(); }
 
+		unsigned inline minDistance() const { return getMinValue<3>(); }
+		unsigned inline maxDistance() const { return getMaxValue<3>(); }
+		unsigned inline currentDistance() const { return getValue<3>(); }
+
+		adhd::kernels::Access inline currentAccess() const { return getValue<4>(); }
+
+		uint64_t inline currentHogDelay() const { return getValue<5>(); }
+
+		Sharing inline currentSharing() const { return getValue<6>(); }
+
+		// the swept ranges by name, to set up a Config range by range, e.g.
+		// cfg.sizes() = CAS_arraysize(min, max)
+		CAS_arraysize inline & sizes() { return get<0>(); }
+		CAS_istreams inline & istreams() { return get<1>(); }
+		CAS_alignment inline & alignments() { return get<2>(); }
+		CAS_distance inline & distances() { return get<3>(); }
+		CAS_access inline & accessModes() { return get<4>(); }
+		CAS_delay inline & hogDelays() { return get<5>(); }
+		CAS_sharing inline & sharingModes() { return get<6>(); }
+
 		unsigned threads_min;
 		unsigned threads_max;
 		Pattern ptrn;
 		uint_fast32_t readMiB;
+		adhd::PageBacking pages;
+		// memory placement; mem_node is the target node for Placement::REMOTE.
+		// Random patterns are generated by all threads in parallel, so under
+		// FIRST_TOUCH their pages end up spread over the nodes of all threads
+		// (other patterns are written by thread 0); LOCAL, REMOTE or INTERLEAVE
+		// place the array independently of who generates it.
+		adhd::numa::Placement placement;
+		unsigned mem_node;
+		// when non-negative, pin the threads to the cpus of this node only, in the
+		// order of the affinity policy
+		int cpu_node;
+		// Every hop of a walk visits one node of node_size bytes (a power of two,
+		// between the index size and defaults::node_size_max), reading the index
+		// at its start and the payload bytes following it. Node sizes of a cache
+		// line or a page make each hop touch exactly one line resp. page.
+		size_t node_size;
+		size_t payload;
+		// hint used by the prefetching walks (prefetch distance > 0)
+		adhd::kernels::Prefetch prefetch;
+		// traffic of the hog threads in loaded latency mode, and the size of the
+		// buffer every hog streams through
+		Traffic traffic;
+		size_t hog_size;
+		// every how many hops the sampling walk times a hop, 0 for none
+		unsigned sample_every;
+		// placement of the threads on the allowed cpus
+		adhd::topology::Affinity affinity;
+		// hardware events counted during the timed walk, e.g. Events::to_vector()
+		std::vector<adhd::hwcounters::enum_t> events;
+		adhd::Scheduling scheduling;
+		// sampling of the events during the timed walk (ns), see defaults
+		uint64_t series_period;
+		size_t series_samples;
+		// metrics derived from the events of every row, counting the events
+		// they need along, e.g. adhd::metrics::standard()
+		std::vector<adhd::Metric> metrics;
+		double peak_bandwidth;
 	};
 }
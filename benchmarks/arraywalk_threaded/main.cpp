@@ -1,25 +1,51 @@
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 #include <sstream>
 #include <type_traits>
+#include <vector>
 
 #include "arraywalk.hpp"
+#include "matrix.hpp"
 #include "../benchmark.hpp"
+#include "../hwcounters.hpp"
+#include "../repetition.hpp"
+#include "../timers.hpp"
+#include "../topology.hpp"
 #include "timings.hpp"
 
 using namespace std;
 using namespace arraywalk;
 
-// may throw domain_error when requested alignment is not a power of two
+// may throw domain_error when requested alignment is not a power of two;
+// counting events reruns every point once per pass, see Scheduling
 template <typename INDEX_T>
-static void run_test(ofstream & logfile, unsigned trial) {
+static void run_test(ofstream & logfile, unsigned trial, bool counters = false) {
 	// TODO: think of a less dirty way of printing a timings CSV header
 	static bool wroteHeader = false;
 	try {
-		auto && aw = ArrayWalk<INDEX_T>(Config());
+		Config cfg;
+		if (counters) {
+			// misses per read, to explain the ticks per read on the same row
+#ifdef ADHD_PAPI
+			cfg.events = adhd::Events({ adhd::hwcounters::cache::L1::DCM,
+					adhd::hwcounters::cache::L2::DCM, adhd::hwcounters::cache::L3::TCM,
+					adhd::hwcounters::TLB::DM }).to_vector();
+#else
+			// no generic perf_event for L2; none at all without a hardware PMU
+			if (adhd::PerfStat::counters() > 0)
+				cfg.events = adhd::Events({ adhd::hwcounters::cache::L1::DCM,
+						adhd::hwcounters::cache::L3::TCM, adhd::hwcounters::TLB::DM }).to_vector();
+#endif
+			// and a first diagnosis of what bounds the walk, from the metrics of
+			// the standard set this CPU counts the events of
+			cfg.metrics = adhd::metrics::available(adhd::metrics::standard());
+		}
+		auto && aw = ArrayWalk<INDEX_T>(cfg);
 		const adhd::timing_cb tcb =
 			[&logfile, &trial] (const adhd::Timings & timings) {
 				if (!wroteHeader) {
@@ -35,7 +61,186 @@ static void run_test(ofstream & logfile, unsigned trial) {
 	catch (const length_error &) { /* deliberately ignored */ }
 }
 
+// cross-node latency/bandwidth matrix
+static int run_matrix(const string & filename) {
+	ofstream logfile(filename);
+	if (!logfile) {
+		cerr << "failed to open CSV output file \"" << filename << "\"" << endl;
+		return -1;
+	}
+
+	bool wroteHeader = false;
+	NumaMatrix matrix;
+	matrix.run([&logfile, &wroteHeader] (const adhd::Timings & timings) {
+			if (!wroteHeader) {
+				timings.formatHeader(logfile);
+				wroteHeader = true;
+			}
+			logfile << timings.asCSV();
+			cout << timings.asHuman() << endl;
+			});
+	matrix.formatMatrix(cout);
+	return 0;
+}
+
+// latency of a single walker versus the bandwidth injected by all other cpus,
+// throttled by decreasing delays
+static int run_loaded(const string & filename) {
+	ofstream logfile(filename);
+	if (!logfile) {
+		cerr << "failed to open CSV output file \"" << filename << "\"" << endl;
+		return -1;
+	}
+
+	Config cfg;
+	cfg.threads_min = cfg.threads_max =
+		max<unsigned>(2, static_cast<unsigned>(adhd::topology::allowedCpus().size()));
+	cfg.sizes() = CAS_arraysize(defaults::loaded_size, defaults::loaded_size);
+	cfg.istreams() = CAS_istreams(1);
+	cfg.alignments() = CAS_alignment(defaults::align_min);
+	cfg.ptrn = Pattern::RANDOM;
+	cfg.readMiB = defaults::loaded_MiB;
+	cfg.node_size = defaults::loaded_node_size;
+	cfg.traffic = Traffic::READ;
+	cfg.hogDelays() = CAS_delay({ 20000, 5000, 2500, 1000, 500, 300, 200, 100, 50, 20, 0 });
+
+	bool wroteHeader = false;
+	vector<TimingData> curve;
+	auto && aw = ArrayWalk<uint64_t>(cfg);
+	runBenchmark(aw, [&] (const adhd::Timings & timings) {
+			if (!wroteHeader) {
+				timings.formatHeader(logfile);
+				wroteHeader = true;
+			}
+			logfile << timings.asCSV();
+			cout << timings.asHuman() << endl;
+			curve.push_back(dynamic_cast<const Timings &>(timings).data());
+			});
+
+	cout << setw(14) << "delay ticks" << setw(16) << "injected MB/s"
+		<< setw(18) << "~ticks per read" << endl;
+	for (const auto & td: curve)
+		cout << setw(14) << td.hogDelay
+			<< setw(16) << fixed << setprecision(0)
+			<< (td.hogSeconds > 0 ? (double) td.hogBytes / td.hogSeconds / 1e6 : 0.0)
+			<< setw(18) << setprecision(1) << (double) td.cycles / (double) td.reads << endl;
+	return 0;
+}
+
+// the counted events over a single long walk, sampled at a fixed cadence: a
+// row per thread as usual, and their time series in a second log
+static int run_profile(const string & filename) {
+	const string seriesname = filename + ".series";
+	ofstream logfile(filename);
+	ofstream serieslog(seriesname);
+	if (!logfile || !serieslog) {
+		cerr << "failed to open CSV output files \"" << filename << "\" and \""
+			<< seriesname << "\"" << endl;
+		return -1;
+	}
+
+	// without a hardware PMU (e.g. in VMs), the kernel's software events
+	vector<adhd::hwcounters::enum_t> events;
+#ifdef ADHD_PAPI
+	events = adhd::Events({ adhd::hwcounters::cache::L1::DCM,
+			adhd::hwcounters::cache::L2::DCM, adhd::hwcounters::cache::L3::TCM,
+			adhd::hwcounters::TLB::DM }).to_vector();
+#else
+	if (adhd::PerfStat::counters() > 0)
+		events = adhd::Events({ adhd::hwcounters::cache::L1::DCM,
+				adhd::hwcounters::cache::L3::TCM, adhd::hwcounters::TLB::DM }).to_vector();
+	else
+		events = { adhd::hwcounters::perf::TASK_CLOCK, adhd::hwcounters::perf::PAGE_FAULTS,
+			adhd::hwcounters::perf::CONTEXT_SWITCHES };
+#endif
+	Config cfg;
+	cfg.threads_min = cfg.threads_max = 1;
+	cfg.sizes() = CAS_arraysize(defaults::profile_size, defaults::profile_size);
+	cfg.istreams() = CAS_istreams(1);
+	cfg.alignments() = CAS_alignment(defaults::align_min);
+	cfg.ptrn = Pattern::RANDOM;
+	cfg.readMiB = defaults::profile_MiB;
+	cfg.node_size = defaults::profile_node_size;
+	cfg.events = events;
+	cfg.series_period = defaults::profile_period;
+
+	bool wroteHeader = false;
+	auto && aw = ArrayWalk<uint64_t>(cfg);
+	runBenchmark(aw, [&] (const adhd::Timings & timings) {
+			const Timings & t = dynamic_cast<const Timings &>(timings);
+			if (!wroteHeader) {
+				t.formatHeader(logfile);
+				t.formatSeriesHeader(serieslog);
+				wroteHeader = true;
+			}
+			logfile << t.asCSV();
+			t.formatSeries(serieslog);
+			cout << t.asHuman() << endl;
+			});
+	return 0;
+}
+
+// repeat every point of the default sweep until the median latency over all
+// threads is known to within the default confidence interval width, logging a
+// summary row per point
+static int run_adaptive(const string & filename) {
+	ofstream logfile(filename);
+	if (!logfile) {
+		cerr << "failed to open CSV output file \"" << filename << "\"" << endl;
+		return -1;
+	}
+
+	bool wroteHeader = false;
+	auto && aw = ArrayWalk<uint64_t>(Config());
+	adhd::Repeater repeater([] (const adhd::Timings & timings) {
+			const TimingData & td = dynamic_cast<const Timings &>(timings).data();
+			return (double) td.cycles / (double) td.reads;
+			});
+	repeater.run(aw, [] (const adhd::Timings &) {},
+			[&logfile, &wroteHeader] (const adhd::statistics::Summary & summary) {
+			if (!wroteHeader) {
+				summary.formatHeader(logfile);
+				wroteHeader = true;
+			}
+			logfile << summary.asCSV();
+			cout << summary.asHuman() << endl;
+			});
+	return 0;
+}
+
 int main(int argc, char * argv[]) {
+	// calibrates the TSC before any measurement
+	adhd::timers::describe(cerr) << endl;
+
+	// "numa" as first argument measures the cross-node matrix instead, with an
+	// optional second argument determining the csv log filename
+	if (argc > 1 && string(argv[1]) == "numa")
+		return run_matrix(argc > 2 ? argv[2] : "numamatrix.log");
+
+	// "loaded" measures the loaded latency curve instead, idem
+	if (argc > 1 && string(argv[1]) == "loaded")
+		return run_loaded(argc > 2 ? argv[2] : "loaded.log");
+
+	// "adaptive" repeats every point until its median converges, idem
+	if (argc > 1 && string(argv[1]) == "adaptive")
+		return run_adaptive(argc > 2 ? argv[2] : "adaptive.log");
+
+	// "profile" samples the counters during one long walk, idem
+	if (argc > 1 && string(argv[1]) == "profile")
+		return run_profile(argc > 2 ? argv[2] : "profile.log");
+
+	// "counters" runs the default sweep once, counting cache and TLB misses and
+	// deriving what bounds every point from them, idem
+	if (argc > 1 && string(argv[1]) == "counters") {
+		const string countersname = argc > 2 ? argv[2] : "counters.log";
+		ofstream logfile(countersname);
+		if (!logfile) {
+			cerr << "failed to open CSV output file \"" << countersname << "\"" << endl;
+			return -1;
+		}
+		run_test<uint64_t>(logfile, 1, true);
+		return 0;
+	}
 
 	unsigned trials = 1;
 	string filename = "arraywalk.log";
@@ -0,0 +1,165 @@
+#include "matrix.hpp"
+
+#include "arraywalk.hpp"
+#include "timings.hpp"
+#include "../memory.hpp"
+#include "../numa.hpp"
+#include "../prettyprint.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+using namespace adhd;
+using namespace prettyprint;
+using namespace std;
+
+/* see timings.cpp */
+#ifdef __INTEL_COMPILER
+#pragma warning(disable:869)
+#endif
+
+namespace arraywalk {
+
+	// keep the streaming reads from being optimized away
+	static volatile uint64_t sink;
+
+	MatrixTimings::MatrixTimings(const MatrixData & _md):
+		md(_md)
+	{}
+
+	MatrixTimings * MatrixTimings::clone() const { return new MatrixTimings(*this); }
+
+	ostream & MatrixTimings::formatHeader(ostream & out) const {
+		out << "cpu node, memory node, ticks, reads, bytes streamed, seconds" << endl;
+		return out;
+	}
+
+	ostream & MatrixTimings::formatCSV(ostream & out) const {
+		return sequence(out, md.cpuNode, md.memNode, md.cycles, md.reads,
+				md.bytes, md.seconds);
+	}
+
+	ostream & MatrixTimings::formatHuman(ostream & out) const {
+		out << "cpu node " << md.cpuNode << " -> memory node " << md.memNode << endl;
+		out << "~ticks per read: "
+			<< (double) md.cycles / (double) md.reads << endl;
+		out << "stream: " << Bytes(md.bytes) << " in " << md.seconds << " s = "
+			<< Bytes((uint64_t) ((double) md.bytes / md.seconds)) << "/s" << endl;
+		return out;
+	}
+
+	NumaMatrix::NumaMatrix(size_t _size, uint_fast32_t _MiB, unsigned _passes):
+		size(_size),
+		MiB(_MiB),
+		passes(_passes),
+		entries()
+	{}
+
+	void NumaMatrix::run(timing_cb tcb) {
+		entries.clear();
+		for (const auto cpuNode: numa::cpuNodes())
+			for (const auto memNode: numa::memoryNodes()) {
+				MatrixData md { cpuNode, memNode, 0, 0, 0, 0 };
+				latency(md);
+				bandwidth(md);
+				entries.push_back(md);
+				tcb(MatrixTimings(md));
+			}
+	}
+
+	// single walker, random pattern: chase latency
+	void NumaMatrix::latency(MatrixData & md) const {
+		Config cfg;
+		cfg.threads_min = cfg.threads_max = 1;
+		cfg.sizes() = CAS_arraysize(size, size);
+		cfg.istreams() = CAS_istreams(1);
+		cfg.alignments() = CAS_alignment(defaults::align_min);
+		cfg.ptrn = Pattern::RANDOM;
+		cfg.readMiB = MiB;
+		cfg.pages = PageBacking::SMALL;
+		cfg.placement = numa::Placement::REMOTE;
+		cfg.mem_node = md.memNode;
+		cfg.cpu_node = static_cast<int>(md.cpuNode);
+		cfg.node_size = defaults::matrix_node_size;
+		auto && aw = ArrayWalk<uint64_t>(cfg);
+		runBenchmark(aw, [&md] (const adhd::Timings & t) {
+				const TimingData & td = dynamic_cast<const Timings &>(t).data();
+				md.cycles = td.cycles;
+				md.reads = td.reads;
+				});
+	}
+
+	// all cpus of the cpu node read disjoint chunks of the array: bandwidth
+	void NumaMatrix::bandwidth(MatrixData & md) const {
+		PageMemory mem;
+		uint64_t * const data = static_cast<uint64_t *>(
+				mem.map(size, defaults::align_min, PageBacking::SMALL));
+		numa::bind(data, mem.size(), numa::Placement::REMOTE, md.memNode);
+
+		const size_t words = size / sizeof(uint64_t);
+		for (size_t i = 0; i < words; ++i)
+			data[i] = i;
+
+		const size_t nthr = numa::nodeCpus(md.cpuNode).size();
+		const size_t chunk = words / nthr;
+		atomic_size_t waiting(nthr + 1);
+		vector<thread> threads;
+
+		for (size_t t = 0; t < nthr; ++t)
+			threads.emplace_back([&, t] () {
+					numa::runOnNode(md.cpuNode);
+					const uint64_t * const first = data + t * chunk;
+					const uint64_t * const last = t + 1 == nthr ? data + words : first + chunk;
+					--waiting;
+					while (waiting);
+
+					uint64_t sum = 0;
+					for (unsigned pass = 0; pass < passes; ++pass)
+						for (const uint64_t * w = first; w < last; ++w)
+							sum += *w;
+					sink = sum;
+					});
+
+		// release the readers only after taking the start time: they may run to
+		// completion before this thread gets scheduled again
+		while (waiting > 1);
+		const auto start = chrono::steady_clock::now();
+		--waiting;
+		for (auto & thr: threads)
+			thr.join();
+		const auto stop = chrono::steady_clock::now();
+
+		md.bytes = static_cast<uint64_t>(words * sizeof(uint64_t)) * passes;
+		md.seconds = chrono::duration<double>(stop - start).count();
+	}
+
+	ostream & NumaMatrix::formatMatrix(ostream & out) const {
+		const auto cpuNodes = numa::cpuNodes();
+		const auto memNodes = numa::memoryNodes();
+		const auto flags = out.flags();
+
+		auto table = [&] (const char * title, double (*value)(const MatrixData &)) {
+			out << title << endl << setw(8) << "cpu\\mem";
+			for (const auto m: memNodes)
+				out << setw(10) << m;
+			out << endl;
+			for (const auto c: cpuNodes) {
+				out << setw(8) << c;
+				for (const auto m: memNodes)
+					for (const auto & md: entries)
+						if (md.cpuNode == c && md.memNode == m)
+							out << setw(10) << fixed << setprecision(2) << value(md);
+				out << endl;
+			}
+		};
+
+		table("~ticks per read (chase latency)", [] (const MatrixData & md) {
+				return (double) md.cycles / (double) md.reads; });
+		table("GiB/s (streaming read bandwidth)", [] (const MatrixData & md) {
+				return (double) md.bytes / md.seconds / (double) (1 << 30); });
+		out.flags(flags);
+		return out;
+	}
+}
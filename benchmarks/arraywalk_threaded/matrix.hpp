@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../benchmark.hpp"
+#include "config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace arraywalk {
+
+	namespace defaults {
+		// large enough to defeat the last level cache on current hardware
+		static constexpr size_t matrix_size = size_t(1) << 30;
+		static constexpr unsigned matrix_passes = 4;
+		// a cache line per node: every hop of the latency walk is a miss
+		static constexpr size_t matrix_node_size = 64;
+	}
+
+	struct MatrixData {
+		unsigned cpuNode;
+		unsigned memNode;
+		// pointer chase by a single walker on cpuNode, in timer ticks
+		uint64_t cycles;
+		uint64_t reads;
+		// streaming reads by all cpus of cpuNode
+		uint64_t bytes;
+		double seconds;
+	};
+	static_assert(std::is_pod<MatrixData>::value, "struct MatrixData must be a POD");
+
+	class MatrixTimings: public adhd::Timings {
+		public:
+			MatrixTimings(const MatrixData & md);
+			virtual MatrixTimings * clone() const override;
+			virtual std::ostream & formatHeader(std::ostream & out) const override;
+			virtual std::ostream & formatCSV(std::ostream & out) const override;
+			virtual std::ostream & formatHuman(std::ostream & out) const override;
+
+			inline const MatrixData & data() const { return md; }
+
+		private:
+			MatrixData md;
+	};
+
+	// Cross-node latency and bandwidth matrix: for every pair of a node with
+	// cpus and a node with memory, bind an array to the memory node and measure
+	// from the cpu node. Rows of the resulting matrix are cpu nodes, columns are
+	// memory nodes.
+	class NumaMatrix {
+		public:
+			NumaMatrix(size_t size = defaults::matrix_size,
+					uint_fast32_t MiB = defaults::MiB,
+					unsigned passes = defaults::matrix_passes);
+
+			// measure all node pairs, reporting each of them to tcb
+			void run(adhd::timing_cb tcb);
+
+			std::ostream & formatMatrix(std::ostream & out) const;
+
+		private:
+			size_t size;
+			uint_fast32_t MiB;
+			unsigned passes;
+			std::vector<MatrixData> entries;
+
+			void latency(MatrixData & md) const;
+			void bandwidth(MatrixData & md) const;
+	};
+}
@@ -1,8 +1,12 @@
 #include "timings.hpp"
 
 #include "../prettyprint.hpp"
+#include "../timers.hpp"
 
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
 
 using namespace prettyprint;
 using namespace std;
@@ -19,37 +23,117 @@ using namespace std;
 
 namespace arraywalk {
 
-	Timings::Timings(const TimingData & _td):
-		td(_td)
+	Timings::Timings(const TimingData & _td, adhd::EventCounts _ec, adhd::DerivedMetrics _dm):
+		td(_td), ec(move(_ec)), dm(move(_dm))
 	{}
 
+	Timings * Timings::clone() const { return new Timings(*this); }
+
+	// copying reuses the storage of the counts and metrics
+	bool Timings::assign(const adhd::Timings & other) {
+		const Timings * const t = dynamic_cast<const Timings *>(&other);
+		if (!t)
+			return false;
+		*this = *t;
+		return true;
+	}
+
 	ostream & Timings::formatHeader(ostream & out) const {
-		out << "total #threads, thread#, cycles, reads, elements, "
-			"element size, instruction streams, alignment" << endl;
+		out << "total #threads, thread#, ticks, ns, reads, pattern, access, elements, "
+			"element size, node size, payload, instruction streams, sharing, prefetch, "
+			"prefetch distance, baseline ticks, sample every, hop samples, hop p50, "
+			"hop p90, hop p99, hop p99.9, hop max, hog traffic, hog delay ticks, hogs, hog bytes, hog seconds, "
+			"alignment, pages, placement, "
+			"memory node, affinity, cpu, cpu node, setup ticks";
+		ec.formatHeader(out);
+		dm.formatHeader(out) << endl;
 		return out;
 	}
 
 	ostream & Timings::formatCSV(ostream & out) const {
-		return sequence(
-				out, td.totalThreads, td.threadNum, td.cycles, td.reads, td.length,
-				td.idx_size, td.istreams, td.alignment
+		// the event counts and derived metrics continue the line
+		ostringstream row;
+		sequence(
+				row, td.totalThreads, td.threadNum, td.cycles,
+				adhd::timers::Default::ns(td.cycles), td.reads, td.ptrn, td.access,
+				td.length,
+				td.idx_size, td.node_size, td.payload, td.istreams, td.sharing, td.prefetch,
+				td.distance, td.baseCycles, td.sampleEvery, td.hopSamples, td.hopP50,
+				td.hopP90, td.hopP99, td.hopP999, td.hopMax, td.traffic, td.hogDelay, td.hogs, td.hogBytes,
+				td.hogSeconds, td.alignment, td.pages, td.placement,
+				td.memNode, td.affinity, td.cpu, td.cpuNode, td.setupCycles
 				);
+		const string line = row.str();
+		out << line.substr(0, line.size() - 1);
+		ec.formatCSV(out);
+		return dm.formatCSV(out) << endl;
 	}
 
 	ostream & Timings::formatHuman(ostream & out) const {
 		if (td.totalThreads > 1)
 			out << td.totalThreads << " threads; #" << td.threadNum << " | ";
 
-		out << td.length << " elements x " << Bytes(td.idx_size) << " = "
+		out << td.ptrn << " " << td.access << " | " << td.length << " elements x " << Bytes(td.idx_size) << " = "
 			<< Bytes(td.length * td.idx_size)
+			<< " | " << td.length * td.idx_size / td.node_size << " nodes x "
+			<< Bytes(td.node_size) << " (" << Bytes(td.payload) << " payload)"
 			<< " | " << Bytes(td.alignment) << " aligned"
+			<< " | " << td.pages << " pages"
+			<< " | " << td.placement << " placement";
+		if (td.memNode >= 0)
+			out << " (node " << td.memNode << ")";
+		out << " | cpu " << td.cpu << " (" << td.affinity << ") on node " << td.cpuNode
 			<< " | " << td.istreams
-			<< " instruction streams" << endl;
-		out << "cycles: " << td.cycles << " | ";
-		out << "reads: " << td.reads << " (" << Bytes(td.reads * td.idx_size) << ")" << endl;
-		out << "~cycles per read: "
-			<< (double) td.cycles / (double) td.reads << endl;
+			<< " instruction streams";
+		if (td.totalThreads > 1)
+			out << " | " << td.sharing << " sharing";
+		if (td.distance)
+			out << " | prefetch " << td.prefetch << " " << td.distance << " hops ahead";
+		out << endl;
+		if (td.sampleEvery > 0)
+			out << "ticks per hop (every " << td.sampleEvery << " hops, " << td.hopSamples
+				<< " samples): p50 " << td.hopP50 << " | p90 " << td.hopP90
+				<< " | p99 " << td.hopP99 << " | p99.9 " << td.hopP999
+				<< " | max " << td.hopMax << endl;
+		if (Traffic::NONE != td.traffic) {
+			out << "load: " << td.hogs << " threads streaming (" << td.traffic << ", "
+				<< td.hogDelay << " TSC ticks delay per line): ";
+			if (td.hogSeconds > 0)
+				out << Bytes((uint64_t) ((double) td.hogBytes / td.hogSeconds)) << "/s";
+			else
+				out << "none";
+			out << endl;
+		}
+		out << "setup ticks: " << td.setupCycles << endl;
+		out << "ticks: " << td.cycles << " (" << adhd::timers::Default::ns(td.cycles) << " ns) | ";
+		out << "reads: " << td.reads << " ("
+			<< Bytes(td.reads * (td.idx_size + td.payload)) << ")" << endl;
+		if (!ec.empty()) {
+			out << "events (per read): ";
+			ec.formatHuman(out, td.reads);
+		}
+		if (!dm.empty()) {
+			out << "metrics: ";
+			dm.formatHuman(out);
+		}
+		out << "~ticks per read: "
+			<< (double) td.cycles / (double) td.reads
+			<< " (" << adhd::timers::Default::ns(td.cycles) / (double) td.reads << " ns)";
+		if (td.distance)
+			out << " (without prefetching: "
+				<< (double) td.baseCycles / (double) td.reads << ")";
+		out << endl;
 		return out;
 	}
 
+	ostream & Timings::formatSeriesHeader(ostream & out) const {
+		return ec.formatSeriesHeader(out << "total #threads, thread#, ");
+	}
+
+	ostream & Timings::formatSeries(ostream & out) const {
+		ostringstream row;
+		row << td.totalThreads << "," << td.threadNum << ",";
+		return ec.formatSeries(out, row.str());
+	}
+
 }
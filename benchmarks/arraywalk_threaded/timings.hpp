@@ -1,6 +1,12 @@
 #pragma once
 
 #include "../benchmark.hpp"
+#include "../eventcounts.hpp"
+#include "../memory.hpp"
+#include "../metrics.hpp"
+#include "../numa.hpp"
+#include "../topology.hpp"
+#include "config.hpp"
 
 #include <cstddef>
 #include <cstdint>
@@ -11,24 +17,76 @@ namespace arraywalk {
 	struct TimingData {
 		unsigned totalThreads;
 		unsigned threadNum;
+		// timer ticks (see adhd::timers), not core cycles
 		uint64_t cycles;
 		uint64_t reads;
+		Pattern ptrn;
+		adhd::kernels::Access access;
 		size_t length;
 		size_t idx_size;
+		size_t node_size;
+		size_t payload;
 		unsigned istreams;
+		Sharing sharing;
+		adhd::kernels::Prefetch prefetch;
+		unsigned distance;
+		// ticks of the plain chase, for comparison with prefetching walks
+		uint64_t baseCycles;
+		// per-hop latency percentiles of the sampling walk, in ticks
+		unsigned sampleEvery;
+		uint64_t hopSamples;
+		uint64_t hopP50;
+		uint64_t hopP90;
+		uint64_t hopP99;
+		uint64_t hopP999;
+		uint64_t hopMax;
+		// loaded latency: traffic injected by the hog threads while walking, their
+		// delay per line in TSC ticks
+		Traffic traffic;
+		uint64_t hogDelay;
+		unsigned hogs;
+		uint64_t hogBytes;
+		double hogSeconds;
 		size_t alignment;
+		adhd::PageBacking pages;
+		adhd::numa::Placement placement;
+		int memNode;
+		// the cpu the thread ran on, as placed by the affinity policy
+		adhd::topology::Affinity affinity;
+		unsigned cpu;
+		unsigned cpuNode;
+		uint64_t setupCycles;
 	};
 	static_assert(std::is_pod<TimingData>::value, "struct TimingData must be a POD");
 
 	class Timings: public adhd::Timings {
 		public:
-			Timings(const TimingData & td);
+			Timings(const TimingData & td,
+					adhd::EventCounts ec = adhd::EventCounts(),
+					adhd::DerivedMetrics dm = adhd::DerivedMetrics());
+			virtual Timings * clone() const override;
+			virtual bool assign(const adhd::Timings & other) override;
 			virtual std::ostream & formatHeader(std::ostream & out) const override;
 			virtual std::ostream & formatCSV(std::ostream & out) const override;
 			virtual std::ostream & formatHuman(std::ostream & out) const override;
 
+			// the events sampled during the timed walk (see Config::series_period),
+			// a CSV line per sample led by the thread columns of the row
+			std::ostream & formatSeriesHeader(std::ostream & out) const;
+			std::ostream & formatSeries(std::ostream & out) const;
+
+			inline const TimingData & data() const { return td; }
+
+			inline const adhd::EventCounts & counts() const { return ec; }
+
+			inline const adhd::DerivedMetrics & metrics() const { return dm; }
+
 		private:
 			TimingData td;
+			// hardware events counted during the timed walk
+			adhd::EventCounts ec;
+			// and the metrics derived from them (see Config::metrics)
+			adhd::DerivedMetrics dm;
 	};
 
 }
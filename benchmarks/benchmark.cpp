@@ -1,12 +1,15 @@
 #include "benchmark.hpp"
+#include "hwcounters.hpp"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <ctime>
 #include <stdexcept>
 #include <system_error>
-#include <mutex>
+#include <thread>
 
 #include <pthread.h>
-#include <unistd.h> // linux setaffinity: sysconf
 
 using namespace std;
 
@@ -27,14 +30,109 @@ namespace adhd {
 	}
 	static auto threadMain = reinterpret_cast<void * (*)(void *)>(c_thread_main);
 
-	ThreadedBenchmark::ThreadedBenchmark(unsigned min, unsigned max):
+#ifdef ADHD_PAPI
+	static const char NO_SAMPLING[] =
+		"ThreadedBenchmark: sampling events requires the perf_event backend (a build without ADHD_PAPI)";
+	static const char NO_MULTIPLEX[] =
+		"ThreadedBenchmark: multiplexing events requires the perf_event backend (a build without ADHD_PAPI)";
+#endif
+
+	static inline uint64_t monotonicNs() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+	}
+
+	static inline void sleepUntil(uint64_t ns) {
+		struct timespec ts;
+		ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+		ts.tv_nsec = static_cast<long>(ns % 1000000000);
+		while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL));
+	}
+
+	struct ThreadedBenchmark::Counters {
+		// The samples of a thread, taken by the sampler while the thread counts.
+		// The state hands the thread's counters and ring back and forth: the
+		// sampler only reads them after swapping SAMPLED for READING, and
+		// stopCounting() waits for it to swap back before stopping them.
+		struct Ring {
+			enum: unsigned { IDLE, SAMPLED, READING };
+
+			Ring(): state(IDLE), start(0), ns(), pass(), deltas(), last(), taken(0) {}
+
+			std::atomic_uint state;
+			// monotonicNs() at startCounting()
+			uint64_t start;
+			std::vector<uint64_t> ns;
+			std::vector<unsigned> pass;
+			// capacity rows of a delta per event
+			std::vector<long long> deltas;
+			// the counts at the previous sample, per event
+			std::vector<long long> last;
+			// samples taken during the run, the last 'capacity' of which are kept
+			uint64_t taken;
+		};
+
+		Counters(): events(), scheduling(Scheduling::PASSES), passes(), pass(0), stats(),
+			period(0), capacity(0), rings() {}
+
+		std::vector<hwcounters::enum_t> events;
+		Scheduling scheduling;
+		// the events counted in every pass of a run, as indices into events
+		std::vector<std::vector<size_t>> passes;
+		unsigned pass;
+		// per thread and pass, made by every thread itself once it first runs
+		// after countEvents()
+		std::vector<std::vector<std::unique_ptr<PerfStat>>> stats;
+		// sampling, see sampleEvents(): disabled for a zero period
+		std::chrono::nanoseconds period;
+		size_t capacity;
+		std::unique_ptr<Ring[]> rings;
+
+		inline bool sampling() const { return period.count() > 0 && !events.empty(); }
+
+		// the counts since start of the current pass, as a sample at time ns
+		void push(Ring & ring, uint64_t ns, const std::vector<long long> & values) {
+			const size_t slot = static_cast<size_t>(ring.taken++ % capacity);
+			long long * delta = &ring.deltas[slot * events.size()];
+			ring.ns[slot] = ns;
+			ring.pass[slot] = pass;
+			fill(delta, delta + events.size(), -1);
+			const auto & counted = passes[pass];
+			for (size_t i = 0; i < counted.size(); ++i) {
+				delta[counted[i]] = values[i] - ring.last[counted[i]];
+				ring.last[counted[i]] = values[i];
+			}
+		}
+
+		// the kept samples, oldest first; the counts reserved room for them
+		void unroll(const Ring & ring, EventCounts & counts) const {
+			const uint64_t kept = min<uint64_t>(ring.taken, capacity);
+			counts.samples.clear();
+			counts.deltas.clear();
+			counts.dropped = ring.taken - kept;
+			for (uint64_t s = ring.taken - kept; s < ring.taken; ++s) {
+				const size_t slot = static_cast<size_t>(s % capacity);
+				counts.samples.push_back(EventCounts::Sample { ring.ns[slot], ring.pass[slot] });
+				counts.deltas.insert(counts.deltas.end(), &ring.deltas[slot * events.size()],
+						&ring.deltas[(slot + 1) * events.size()]);
+			}
+		}
+	};
+
+	ThreadedBenchmark::ThreadedBenchmark(unsigned min, unsigned max, topology::Affinity _affinity):
 		AffineStepper(min, max),
-		callback_mutex(),
 		tcb(),
+		slots(max),
+		counters(new Counters()),
+		counts(max),
 		pthreadIDs(max),
 		bmThreads(max),
+		threadCpus(max),
+		affinity(_affinity),
 		stopThreads(false),
 		runningThreads(0),
+		phaseThreads(0),
 		spin_go(0),
 		spin_go_wait(0)
 	{
@@ -43,76 +141,52 @@ namespace adhd {
 	}
 
 	// clean up threads when class gets destructed (hide implementation detail)
-	ThreadedBenchmark::~ThreadedBenchmark() { joinThreads(true); }
-
-#ifdef __ICC
-				// XXX ICC spurious warning workaround - having a static_cast still
-				// triggers an implicit conversion warning, a C-style cast doesn't
-#define STATIC_CAST(t) (t)
-#else
-#define STATIC_CAST(t) static_cast<t>
-#endif
+	ThreadedBenchmark::~ThreadedBenchmark() {
+		joinThreads();
+	}
 
-	// linux-specific way of setting thread affinity
-	// TODO: integrate this code to its calling site to prevent many redundant sysconf calls
-	static inline void setaffinity_linux(const unsigned tnum, const unsigned stride, const pthread_t & thread) {
-		// CPU_SET accepts int as its first argument, implying that the total
-		// number of cores also must be <= INT_MAX
-		const long sysret = sysconf(_SC_NPROCESSORS_ONLN);
-		switch (sysret) {
-			case -1:
-				throw system_error(-1, generic_category(), strerror(errno));
-				break;
-			case 0:
-				throw runtime_error("OS reports 0 processors online. What processor is this program even running on?");
-				break;
-			default:
-				const long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
-				int core_id;
-
-				if (0 == stride) {
-					core_id = 0;
-				}
-				else {
-					if (num_cores % stride)
-						throw runtime_error("Value for 'stride' must be a whole divisor of the number of processors online.");
+	// entry and exit barriers: the whole pool and the thread calling run()
+	void ThreadedBenchmark::init_barriers() {
+		const unsigned pool = maxThreads();
 
-					// 'block' + 'offset in block'
-					const long cores_per_block = num_cores / stride;
-					core_id = STATIC_CAST(int)(((tnum * stride) % num_cores) + ((tnum / cores_per_block) % cores_per_block));
-				}
+		pthread_barrier_init(&runThreads_entry_b, NULL, pool + 1);
+		pthread_barrier_init(&runThreads_exit_b, NULL, pool + 1);
+	}
 
-				cpu_set_t cpuset;
-				CPU_ZERO(&cpuset);
-				CPU_SET(core_id, &cpuset);
-				pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+	void ThreadedBenchmark::destroy_barriers() {
+		pthread_barrier_destroy(&runThreads_entry_b);
+		pthread_barrier_destroy(&runThreads_exit_b);
+
+		destroy_phase_barriers();
+	}
+
+	void ThreadedBenchmark::destroy_phase_barriers() {
+		if (phaseThreads > 0) {
+			pthread_barrier_destroy(&init_b);
+			pthread_barrier_destroy(&ready_b);
+			pthread_barrier_destroy(&set_b);
+			pthread_barrier_destroy(&go_b);
+			pthread_barrier_destroy(&go_wait_b);
+			pthread_barrier_destroy(&finish_b);
+			phaseThreads = 0;
 		}
 	}
 
-	void ThreadedBenchmark::init_barriers() {
+	// phase barriers: the threads taking part in a run; only called while the
+	// pool waits at the entry barrier
+	void ThreadedBenchmark::resize_phase_barriers() {
 		const unsigned nthr = numThreads();
 
-		pthread_barrier_init(&runThreads_entry_b, NULL, nthr + 1);
-		pthread_barrier_init(&runThreads_exit_b, NULL, nthr + 1);
-
+		if (phaseThreads == nthr)
+			return;
+		destroy_phase_barriers();
 		pthread_barrier_init(&init_b, NULL, nthr);
 		pthread_barrier_init(&ready_b, NULL, nthr);
 		pthread_barrier_init(&set_b, NULL, nthr);
 		pthread_barrier_init(&go_b, NULL, nthr);
 		pthread_barrier_init(&go_wait_b, NULL, nthr);
 		pthread_barrier_init(&finish_b, NULL, nthr);
-	}
-
-	void ThreadedBenchmark::destroy_barriers() {
-		pthread_barrier_destroy(&runThreads_entry_b);
-		pthread_barrier_destroy(&runThreads_exit_b);
-
-		pthread_barrier_destroy(&init_b);
-		pthread_barrier_destroy(&ready_b);
-		pthread_barrier_destroy(&set_b);
-		pthread_barrier_destroy(&go_b);
-		pthread_barrier_destroy(&go_wait_b);
-		pthread_barrier_destroy(&finish_b);
+		phaseThreads = nthr;
 	}
 
 	inline void startWaitingThreads(pthread_barrier_t * b) {
@@ -123,49 +197,90 @@ namespace adhd {
 	void ThreadedBenchmark::run(timing_cb newtcb) {
 		// shared-memory assignment is OK because of this method's precondition
 		tcb = newtcb;
-		// join threads only if #threads changed (i.e. don't force)
-		joinThreads(false);
-		// if needed, spawn threads
+		// if needed, spawn the pool
 		spawnThreads();
-		// unblock all threads waiting to execute
-		startWaitingThreads(&runThreads_entry_b);
-		// block this method until all threads finished executing
-		startWaitingThreads(&runThreads_exit_b);
+		resize_phase_barriers();
+		makeRecords();
+		// counting more events than fit in the counters may take several passes,
+		// only the records of the last one are reported
+		const size_t passes = max<size_t>(1, counters->passes.size());
+		// samples the counters while the threads count, see sampleEvents()
+		atomic_bool stopSampler(false);
+		thread sampler;
+		if (counters->sampling())
+			sampler = thread([this, &stopSampler] { runSampler(stopSampler); });
+		for (counters->pass = 0; counters->pass < passes; ++counters->pass) {
+			for (unsigned t = 0; t < numThreads(); ++t)
+				slots[t].used = 0;
+			// unblock all threads waiting to execute
+			startWaitingThreads(&runThreads_entry_b);
+			// block this method until all threads finished executing
+			startWaitingThreads(&runThreads_exit_b);
+		}
+		if (sampler.joinable()) {
+			stopSampler = true;
+			sampler.join();
+		}
+		drainRecords();
+	}
+
+	// records of the threads taking part that have none yet, made here rather
+	// than while the threads run; only called while all threads wait at a
+	// barrier
+	void ThreadedBenchmark::makeRecords() {
+		for (unsigned t = 0; t < numThreads(); ++t) {
+			auto & records = slots[t].records;
+			if (!records.empty())
+				continue;
+			records.reserve(RECORDS_RESERVED);
+			for (size_t r = 0; r < RECORDS_RESERVED; ++r) {
+				Timings * const record = makeRecord(t);
+				if (!record)
+					break;
+				records.emplace_back(record);
+			}
+		}
+	}
+
+	// only called while all threads wait at a barrier
+	void ThreadedBenchmark::drainRecords() {
+		for (unsigned t = 0; t < numThreads(); ++t) {
+			auto & slot = slots[t];
+			for (size_t r = 0; r < slot.used; ++r)
+				tcb(*slot.records[r]);
+			slot.used = 0;
+		}
 	}
 
 	void ThreadedBenchmark::spawnThreads() {
-		const unsigned nthr = numThreads();
+		const unsigned pool = maxThreads();
 
 		if(!runningThreads) {
+			const auto cpus = poolCpus();
 			init_barriers();
-			for (unsigned t = 0; t < nthr; ++t) {
+			for (unsigned t = 0; t < pool; ++t) {
 				bmThreads[t] = BenchmarkThread {t, this};
 				const int rc = pthread_create(&pthreadIDs[t], NULL, threadMain, &bmThreads[t]);
 				if (rc) { throw system_error(rc, generic_category(), strerror(rc)); }
-				// TODO: propagate support for multiple thread allocation schemes
-				setaffinity_linux(t, 1, pthreadIDs[t]);
+				threadCpus[t] = cpus[t % cpus.size()];
+				topology::runOnCpu(pthreadIDs[t], threadCpus[t]);
 			}
-			runningThreads = nthr;
+			runningThreads = pool;
 		}
 	}
 
-	void ThreadedBenchmark::joinThreads(bool force) {
-		const unsigned nthr = numThreads();
-
+	void ThreadedBenchmark::joinThreads() {
 		// only join threads when they are actually running
-		if (runningThreads > 0)
-			// only join running threads when forced (e.g. destructor) or the number
-			// of active threads changed
-			if (force || (runningThreads != nthr)) {
-				stopThreads = true;
-				startWaitingThreads(&runThreads_entry_b);
-
-				for (unsigned t = 0; t < runningThreads; ++t)
-					pthread_join(pthreadIDs[t], NULL);
-				destroy_barriers();
-				stopThreads = false;
-				runningThreads = 0;
-			}
+		if (runningThreads > 0) {
+			stopThreads = true;
+			startWaitingThreads(&runThreads_entry_b);
+
+			for (unsigned t = 0; t < runningThreads; ++t)
+				pthread_join(pthreadIDs[t], NULL);
+			destroy_barriers();
+			stopThreads = false;
+			runningThreads = 0;
+		}
 	}
 
 	ostream & operator<<(std::ostream & os, const ThreadedBenchmark & tb) {
@@ -176,6 +291,11 @@ namespace adhd {
 		for (;;) {
 			startWaitingThreads(&runThreads_entry_b);
 			if (stopThreads) { return; }
+			// parked: not taking part in this run
+			if (threadNum >= numThreads()) {
+				startWaitingThreads(&runThreads_exit_b);
+				continue;
+			}
 
 			{ // init
 				const int isSerial = pthread_barrier_wait(&init_b);
@@ -186,6 +306,7 @@ namespace adhd {
 				} }
 			{ // ready
 				pthread_barrier_wait(&ready_b);
+				prepareCounting(threadNum);
 				ready(threadNum); }
 			{ // set
 				pthread_barrier_wait(&set_b);
@@ -205,13 +326,180 @@ namespace adhd {
 		}
 	}
 
-	// timing_callback serializes all calls to the callback supplied to run()
-	void ThreadedBenchmark::timing_callback(const Timings & t) {
-		auto && ul = unique_lock<mutex>(callback_mutex);
-		tcb(t);
-		ul.unlock();
+	// timing_callback defers the callback supplied to run() until all threads
+	// finished, see drainRecords(); it only allocates when the records made for
+	// the thread do not take the copy
+	void ThreadedBenchmark::timing_callback(unsigned threadNum, const Timings & t) {
+		auto & slot = slots[threadNum];
+		if (slot.used < slot.records.size()) {
+			auto & record = slot.records[slot.used];
+			if (!record->assign(t))
+				record.reset(t.clone());
+		}
+		else
+			slot.records.emplace_back(t.clone());
+		++slot.used;
 	}
 
+	// threads are at a barrier when this method is called (or it's a bug)
+	void ThreadedBenchmark::countEvents(const vector<hwcounters::enum_t> & events,
+			Scheduling scheduling)
+	{
+		counters->passes.clear();
+		if (!events.empty()) {
+#ifdef ADHD_PAPI
+			// PAPI does not tell how long multiplexed events were counted
+			if (Scheduling::MULTIPLEX == scheduling)
+				throw runtime_error(NO_MULTIPLEX);
+			papi_threads_init();
+#endif
+			if (Scheduling::MULTIPLEX == scheduling) {
+				counters->passes.push_back(vector<size_t>());
+				for (size_t e = 0; e < events.size(); ++e)
+					counters->passes.back().push_back(e);
+			}
+			else {
+				// the lists keep the order of the events
+				size_t e = 0;
+				for (const auto & list: PerfStat::schedule(events)) {
+					counters->passes.push_back(vector<size_t>());
+					for (size_t i = 0; i < list.size(); ++i)
+						counters->passes.back().push_back(e++);
+				}
+			}
+		}
+		counters->stats.clear();
+		counters->stats.resize(maxThreads());
+		counters->events = events;
+		counters->scheduling = scheduling;
+		for (auto & c: counts) {
+			c.events = events;
+			c.names.clear();
+			for (const auto e: events)
+				c.names.push_back(hwcounters::names::lookup(e));
+			c.values.assign(events.size(), 0);
+			c.coverage.assign(events.size(), 1);
+			c.passes = static_cast<unsigned>(counters->passes.size());
+		}
+		prepareSampling();
+	}
+
+	// threads are at a barrier when this method is called (or it's a bug)
+	void ThreadedBenchmark::sampleEvents(chrono::nanoseconds period, size_t capacity) {
+#ifdef ADHD_PAPI
+		if (period.count() > 0)
+			throw runtime_error(NO_SAMPLING);
+#endif
+		counters->period = period;
+		counters->capacity = max<size_t>(1, capacity);
+		prepareSampling();
+	}
+
+	// rings and room for their samples in the counts, allocated before any run;
+	// records are made anew for counts of the new size
+	void ThreadedBenchmark::prepareSampling() {
+		const size_t events = counters->events.size();
+		const size_t capacity = counters->sampling() ? counters->capacity : 0;
+
+		counters->rings.reset(counters->sampling() ? new Counters::Ring[maxThreads()] : NULL);
+		for (unsigned t = 0; t < maxThreads(); ++t) {
+			if (counters->sampling()) {
+				auto & ring = counters->rings[t];
+				ring.ns.resize(capacity);
+				ring.pass.resize(capacity);
+				ring.deltas.resize(capacity * events);
+				ring.last.resize(events);
+			}
+			counts[t].samples.clear();
+			counts[t].samples.reserve(capacity);
+			counts[t].deltas.clear();
+			counts[t].deltas.reserve(capacity * events);
+			counts[t].dropped = 0;
+			slots[t].records.clear();
+		}
+	}
+
+	// Sample every period, skipping the ticks missed when falling behind
+	// rather than catching up on them in a burst. The sampler is not pinned:
+	// on a fully loaded machine it competes with the counting threads.
+	void ThreadedBenchmark::runSampler(const atomic_bool & stop) {
+		const uint64_t period = static_cast<uint64_t>(counters->period.count());
+		uint64_t next = monotonicNs();
+
+		while (!stop) {
+			next = max(next + period, monotonicNs());
+			sleepUntil(next);
+			for (unsigned t = 0; t < numThreads(); ++t)
+				sample(t);
+		}
+	}
+
+	void ThreadedBenchmark::sample(unsigned threadNum) {
+		auto & ring = counters->rings[threadNum];
+		unsigned sampled = Counters::Ring::SAMPLED;
+
+		if (!ring.state.compare_exchange_strong(sampled, Counters::Ring::READING))
+			return;
+		const auto & values = counters->stats[threadNum][counters->pass]->read();
+		counters->push(ring, monotonicNs() - ring.start, values);
+		ring.state = Counters::Ring::SAMPLED;
+	}
+
+	// an event set per pass, made in the thread counting with it
+	void ThreadedBenchmark::prepareCounting(unsigned threadNum) {
+		auto & stats = counters->stats[threadNum];
+		if (!counters->events.empty() && stats.empty())
+			for (const auto & pass: counters->passes) {
+				vector<hwcounters::enum_t> events;
+				for (const auto e: pass)
+					events.push_back(counters->events[e]);
+				stats.emplace_back(new PerfStat(events,
+							Scheduling::MULTIPLEX == counters->scheduling));
+			}
+	}
+
+	void ThreadedBenchmark::startCounting(unsigned threadNum) {
+		if (!counters->events.empty())
+			counters->stats[threadNum][counters->pass]->start();
+		if (counters->sampling()) {
+			auto & ring = counters->rings[threadNum];
+			if (0 == counters->pass)
+				ring.taken = 0;
+			fill(ring.last.begin(), ring.last.end(), 0);
+			ring.start = monotonicNs();
+			ring.state = Counters::Ring::SAMPLED;
+		}
+	}
+
+	void ThreadedBenchmark::stopCounting(unsigned threadNum) {
+		if (counters->sampling()) {
+			// wait for a sample being taken
+			auto & ring = counters->rings[threadNum];
+			unsigned sampled = Counters::Ring::SAMPLED;
+			while (!ring.state.compare_exchange_weak(sampled, Counters::Ring::IDLE))
+				sampled = Counters::Ring::SAMPLED;
+		}
+		if (!counters->events.empty()) {
+			const auto & pass = counters->passes[counters->pass];
+			const auto & stat = counters->stats[threadNum][counters->pass]->stop();
+			for (size_t i = 0; i < pass.size(); ++i) {
+				counts[threadNum].values[pass[i]] = stat.getValues()[i];
+				counts[threadNum].coverage[pass[i]] = stat.getCoverage()[i];
+			}
+			// the rest of the pass makes the last sample
+			if (counters->sampling()) {
+				auto & ring = counters->rings[threadNum];
+				counters->push(ring, monotonicNs() - ring.start, stat.getValues());
+				if (counters->pass + 1 == counters->passes.size())
+					counters->unroll(ring, counts[threadNum]);
+			}
+		}
+	}
+
+	Timings * ThreadedBenchmark::makeRecord(unsigned) const { return NULL; }
+
+	vector<unsigned> ThreadedBenchmark::poolCpus() const { return topology::cpuOrder(affinity); }
+
 	// placeholders: no pure virtual methods to allow children to override no
 	// more methods than they need, leaving only go() as abstract method
 	void ThreadedBenchmark::init(unsigned) {}
@@ -1,11 +1,15 @@
 #pragma once
 
+#include "eventcounts.hpp"
+#include "memory.hpp"
 #include "range.hpp"
 #include "timings.hpp"
+#include "topology.hpp"
 
 #include <atomic>
+#include <chrono>
 #include <iterator>
-#include <mutex>
+#include <memory>
 #include <pthread.h>
 #include <vector>
 
@@ -40,10 +44,15 @@ namespace adhd {
 			virtual SingleBenchmark * clone() const override = 0;
 	};
 
-	// Threaded benchmark: run a number of threads as simultaneously as possible
+	// Threaded benchmark: run a number of threads as simultaneously as possible.
+	// The first run spawns a pool of maxThreads() threads, pinned to cpus in the
+	// order of the affinity policy, that lives as long as the benchmark:
+	// changing numThreads() only resizes the phase barriers, the threads beyond
+	// numThreads() are parked during a run.
 	class ThreadedBenchmark: public virtual BenchmarkInterface, public AffineStepper<unsigned> {
 		public:
-			ThreadedBenchmark(unsigned minThreads, unsigned maxThreads);
+			ThreadedBenchmark(unsigned minThreads, unsigned maxThreads,
+					topology::Affinity affinity = topology::Affinity::COMPACT);
 			ThreadedBenchmark(const ThreadedBenchmark &) = delete;
 			virtual ~ThreadedBenchmark();
 
@@ -55,6 +64,25 @@ namespace adhd {
 			inline unsigned minThreads() const { return minValue; }
 			inline unsigned maxThreads() const { return maxValue; }
 			inline unsigned numThreads() const { return getValue(); }
+			inline topology::Affinity threadAffinity() const { return affinity; }
+
+			// Hardware events every thread counts from startCounting() to
+			// stopCounting(), e.g. Events::to_vector(); call between runs. Counting
+			// goes through PAPI in a build with ADHD_PAPI, through perf_event
+			// otherwise; an empty list disables it.
+			// Events exceeding the counters are scheduled as requested: multiplexed
+			// (perf_event only), or in passes, every run then running all phases
+			// once per pass.
+			void countEvents(const std::vector<hwcounters::enum_t> & events,
+					Scheduling scheduling = Scheduling::PASSES);
+
+			// Sample the counted events every period while counting, keeping the
+			// last 'capacity' samples of every thread in a ring allocated here and
+			// reported with its counts (see EventCounts::samples). A thread of its
+			// own takes the samples, reading the counters of the counting threads
+			// without stopping them: requires the perf_event backend. Call between
+			// runs; a zero period disables sampling.
+			void sampleEvents(std::chrono::nanoseconds period, size_t capacity);
 
 			friend std::ostream & operator<<(std::ostream &, const ThreadedBenchmark &);
 
@@ -67,10 +95,18 @@ namespace adhd {
 			};
 
 		protected:
-			// timing_callback passes its argument to the timing_cb that was supplied
-			// to run(timing_cb), and makes sure (by using a mutex) that no callback
-			// executions overlap
-			timing_cb_t timing_callback;
+			// timing_callback copies its argument into the next free record of the
+			// calling thread (see makeRecord()); run(timing_cb) passes the records
+			// of all threads to the timing_cb supplied to it once all threads have
+			// finished, in thread order, so no thread ever waits for another's
+			// callback
+			void timing_callback(unsigned threadNum, const Timings &);
+
+			// a record of the concrete type a thread reports, for run() to allocate
+			// before the threads run, so that reporting only copies into it (see
+			// Timings::assign); NULL, the default, leaves timing_callback to clone
+			// what is reported
+			virtual Timings * makeRecord(unsigned threadNum) const;
 
 			// placeholders: no pure virtual methods to allow children to override no
 			// more methods than they need, leaving only go() as abstract method
@@ -80,6 +116,14 @@ namespace adhd {
 			virtual void go(unsigned threadNum) = 0;
 			virtual void finish(unsigned threadNum);
 
+			// cpu a thread was pinned to when it was spawned
+			inline unsigned threadCpu(unsigned threadNum) const { return threadCpus[threadNum]; }
+
+			// cpus to pin the pool to, thread t to the t-th, wrapping around when
+			// threads outnumber cpus: by default all allowed cpus in the order of
+			// the affinity policy
+			virtual std::vector<unsigned> poolCpus() const;
+
 			// synchronize in go() method before executing the actual benchmark code
 			// e.g. loop variant setup depending on local state
 			inline void go_wait_start() { --spin_go_wait; while(spin_go_wait); }
@@ -89,25 +133,66 @@ namespace adhd {
 			// timing results
 			inline void go_wait_end() { pthread_barrier_wait(&go_wait_b); }
 
+			// count hardware events (see countEvents) of the code in between: call
+			// right after go_wait_start() and before go_wait_end()
+			void startCounting(unsigned threadNum);
+			void stopCounting(unsigned threadNum);
+			// the counts of the last stopCounting()
+			inline const EventCounts & eventCounts(unsigned threadNum) const { return counts[threadNum]; }
+
 		private:
-			std::mutex callback_mutex;
+			// Records of a thread, made by run() before the threads run and kept
+			// across runs; a run fills the first 'used' of them. Only the owning
+			// thread fills them, and only run() drains them, after the exit
+			// barrier has ordered all reports before the drain: no locking or
+			// atomics needed. Every slot has a cache line of its own, and the
+			// records are made slot after slot, so that filling them neither
+			// invalidates nor waits for lines of other threads.
+			static constexpr size_t CACHE_LINE = 64;
+			struct alignas(CACHE_LINE) RecordSlot {
+				std::vector<std::unique_ptr<Timings>> records;
+				size_t used;
+			};
+			static_assert(sizeof(RecordSlot) == CACHE_LINE, "RecordSlot exceeds a cache line");
+			// records per slot; a thread reporting more clones the rest
+			static constexpr size_t RECORDS_RESERVED = 16;
+
 			timing_cb tcb;
+			std::vector<RecordSlot, AlignedAllocator<RecordSlot>> slots;
+
+			void makeRecords();
+			void drainRecords();
+
+			// per-thread counters of the counting backend, see benchmark.cpp
+			struct Counters;
+			std::unique_ptr<Counters> counters;
+			std::vector<EventCounts> counts;
+			void prepareCounting(unsigned threadNum);
+			void prepareSampling();
+			void runSampler(const std::atomic_bool & stop);
+			void sample(unsigned threadNum);
 
 			void runThread(unsigned threadNum);
 			void init_barriers();
 			void destroy_barriers();
+			void resize_phase_barriers();
+			void destroy_phase_barriers();
 
 			void spawnThreads();
-			void joinThreads(bool force);
+			void joinThreads();
 
 			std::vector<pthread_t> pthreadIDs;
 			std::vector<BenchmarkThread> bmThreads;
+			std::vector<unsigned> threadCpus;
+			const topology::Affinity affinity;
 
 			pthread_barrier_t runThreads_entry_b;
 			pthread_barrier_t runThreads_exit_b;
 			bool stopThreads;
 
 			unsigned runningThreads;
+			// number of threads the phase barriers are initialized for
+			unsigned phaseThreads;
 
 			std::atomic_uint spin_go;
 			std::atomic_uint spin_go_wait;
@@ -0,0 +1,55 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "matrix.hpp"
+#include "../timers.hpp"
+#include "../topology.hpp"
+#include "timings.hpp"
+
+using namespace std;
+using namespace c2c;
+
+int main(int argc, char * argv[]) {
+	// calibrates the TSC before any measurement
+	adhd::timers::describe(cerr) << endl;
+	// optional first argument determines the csv log filename, the optional
+	// second one the number of round trips per pair
+	const string filename = argc > 1 ? argv[1] : "c2c.log";
+	uint64_t rounds = defaults::rounds;
+	if (argc > 2) {
+		stringstream convert(argv[2]);
+		uint64_t tmp;
+		if (convert >> tmp && tmp > 0)
+			rounds = tmp;
+	}
+	if (argc > 3)
+		cerr << "warning: third and subsequent arguments ignored" << endl;
+
+	if (adhd::topology::allowedCpus().size() < 2) {
+		cerr << "core to core latencies require at least two allowed cpus" << endl;
+		return -1;
+	}
+
+	ofstream logfile(filename);
+	if (!logfile) {
+		cerr << "failed to open CSV output file \"" << filename << "\"" << endl;
+		return -1;
+	}
+
+	bool wroteHeader = false;
+	CoreMatrix matrix(rounds);
+	matrix.run([&logfile, &wroteHeader] (const adhd::Timings & timings) {
+			if (!wroteHeader) {
+				timings.formatHeader(logfile);
+				wroteHeader = true;
+			}
+			logfile << timings.asCSV();
+			cout << timings.asHuman() << endl;
+			});
+	matrix.formatMatrix(cout);
+	matrix.formatSummary(cout);
+	return 0;
+}
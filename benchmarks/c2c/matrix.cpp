@@ -0,0 +1,112 @@
+#include "matrix.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+using namespace adhd;
+using namespace std;
+
+namespace c2c {
+
+	CoreMatrix::CoreMatrix(uint64_t _rounds, const vector<unsigned> & _cpus):
+		rounds(_rounds),
+		cpus(),
+		entries()
+	{
+		for (const auto cpu: _cpus)
+			cpus.push_back(topology::cpuInfo(cpu));
+	}
+
+	void CoreMatrix::run(timing_cb tcb) {
+		entries.clear();
+		vector<CpuPair> pairs;
+		for (const auto & a: cpus)
+			for (const auto & b: cpus)
+				if (a.cpu != b.cpu)
+					pairs.push_back(CpuPair(a.cpu, b.cpu));
+		// one pool of two threads for all pairs
+		PingPong pp(pairs, rounds);
+		runBenchmark(pp, [this, &tcb] (const adhd::Timings & t) {
+				entries.push_back(dynamic_cast<const Timings &>(t).data());
+				tcb(t);
+				});
+	}
+
+	const PingPongData * CoreMatrix::find(unsigned cpuA, unsigned cpuB) const {
+		for (const auto & pd: entries)
+			if (pd.cpuA == cpuA && pd.cpuB == cpuB)
+				return &pd;
+		return NULL;
+	}
+
+	static inline double roundtrip(const PingPongData & pd) {
+		return (double) pd.cycles / (double) pd.roundtrips;
+	}
+
+	ostream & CoreMatrix::formatMatrix(ostream & out) const {
+		const auto flags = out.flags();
+
+		out << "~ticks per round trip" << endl << setw(8) << "cpu";
+		for (const auto & b: cpus)
+			out << setw(8) << b.cpu;
+		out << endl;
+		for (const auto & a: cpus) {
+			out << setw(8) << a.cpu;
+			for (const auto & b: cpus) {
+				const PingPongData * pd = find(a.cpu, b.cpu);
+				if (pd)
+					out << setw(8) << fixed << setprecision(0) << roundtrip(*pd);
+				else
+					out << setw(8) << "-";
+			}
+			out << endl;
+		}
+
+		// s(mt), l(ast level cache), p(ackage), r(emote)
+		out << "relation (s: smt, l: llc, p: package, r: remote)" << endl << setw(8) << "cpu";
+		for (const auto & b: cpus)
+			out << setw(8) << b.cpu;
+		out << endl;
+		for (const auto & a: cpus) {
+			out << setw(8) << a.cpu;
+			for (const auto & b: cpus) {
+				const char * rel = "-";
+				switch (topology::relation(a, b)) {
+					case topology::Relation::SMT: rel = "s"; break;
+					case topology::Relation::LLC: rel = "l"; break;
+					case topology::Relation::PACKAGE: rel = "p"; break;
+					case topology::Relation::REMOTE: rel = "r"; break;
+					default: break;
+				}
+				out << setw(8) << rel;
+			}
+			out << endl;
+		}
+		out.flags(flags);
+		return out;
+	}
+
+	ostream & CoreMatrix::formatSummary(ostream & out) const {
+		map<topology::Relation, vector<double>> byRelation;
+		for (const auto & pd: entries)
+			byRelation[pd.relation].push_back(roundtrip(pd));
+
+		const auto flags = out.flags();
+		out << left << setw(10) << "relation" << right << setw(8) << "pairs"
+			<< setw(10) << "min" << setw(10) << "median" << setw(10) << "max" << endl;
+		for (auto & rel: byRelation) {
+			vector<double> & rt = rel.second;
+			sort(rt.begin(), rt.end());
+			stringstream name;
+			name << rel.first;
+			out << left << setw(10) << name.str() << right << setw(8) << rt.size()
+				<< fixed << setprecision(1)
+				<< setw(10) << rt.front() << setw(10) << rt[rt.size() / 2]
+				<< setw(10) << rt.back() << endl;
+		}
+		out.flags(flags);
+		return out;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../benchmark.hpp"
+#include "../topology.hpp"
+#include "pingpong.hpp"
+#include "timings.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace c2c {
+
+	// Core to core round trip matrix: ping-pong a line between every ordered
+	// pair of distinct cpus. Rows are the cpus first touching the line, columns
+	// their partners. Pairs are classified by their topological relation (see
+	// adhd::topology::Relation), and summarized per relation.
+	class CoreMatrix {
+		public:
+			CoreMatrix(uint64_t rounds = defaults::rounds,
+					const std::vector<unsigned> & cpus = adhd::topology::allowedCpus());
+
+			// measure all pairs, reporting each of them to tcb
+			void run(adhd::timing_cb tcb);
+
+			std::ostream & formatMatrix(std::ostream & out) const;
+			std::ostream & formatSummary(std::ostream & out) const;
+
+		private:
+			uint64_t rounds;
+			std::vector<adhd::topology::CpuInfo> cpus;
+			std::vector<PingPongData> entries;
+
+			const PingPongData * find(unsigned cpuA, unsigned cpuB) const;
+	};
+}
@@ -0,0 +1,127 @@
+#include "pingpong.hpp"
+
+#include "../timers.hpp"
+#include "../topology.hpp"
+
+#include <new>
+#include <stdexcept>
+
+using namespace adhd;
+using namespace std;
+
+namespace c2c {
+
+	static inline size_t lastPair(const vector<CpuPair> & pairs) {
+		if (pairs.empty())
+			throw invalid_argument("PingPong(): no cpu pairs to measure");
+		return pairs.size() - 1;
+	}
+
+	PingPong::PingPong(const vector<CpuPair> & _pairs, uint64_t _rounds):
+		ThreadedBenchmark(2, 2),
+		pairs(_pairs),
+		pair(0, lastPair(_pairs)),
+		rounds(_rounds),
+		linemem(),
+		flag(NULL)
+	{}
+
+	PingPong::PingPong(unsigned cpuA, unsigned cpuB, uint64_t _rounds):
+		PingPong(vector<CpuPair> { CpuPair(cpuA, cpuB) }, _rounds)
+	{}
+
+	PingPong * PingPong::clone() const {
+		PingPong * pp = new PingPong(pairs, rounds);
+		pp->pair = pair;
+		return pp;
+	}
+
+	adhd::Timings * PingPong::makeRecord(unsigned /*threadNum*/) const {
+		return new Timings(PingPongData());
+	}
+
+	void PingPong::init(unsigned /*threadNum*/) {
+		// a page of its own: nothing else shares the line; mapped anew for every
+		// pair, so that its first touch places it near cpuA
+		linemem.map(pageSize(PageBacking::SMALL), pageSize(PageBacking::SMALL),
+				PageBacking::SMALL);
+	}
+
+	void PingPong::ready(unsigned threadNum) {
+		const CpuPair & cpus = cpuPair();
+		topology::runOnCpu(0 == threadNum ? cpus.first : cpus.second);
+		if (0 == threadNum)
+			flag = new (linemem.data()) atomic<uint64_t>(0);
+	}
+
+	// odd counter values are written by ping, even ones by pong
+	void PingPong::ping(uint64_t first, uint64_t n) {
+		for (uint64_t value = first; value < first + 2 * n; value += 2) {
+			flag->store(value + 1, memory_order_release);
+			while (flag->load(memory_order_acquire) != value + 2);
+		}
+	}
+
+	void PingPong::pong(uint64_t first, uint64_t n) {
+		for (uint64_t value = first; value < first + 2 * n; value += 2) {
+			while (flag->load(memory_order_acquire) != value + 1);
+			flag->store(value + 2, memory_order_release);
+		}
+	}
+
+	void PingPong::go(unsigned threadNum) {
+		go_wait_start();
+		if (0 == threadNum) {
+			ping(0, defaults::warmup);
+			const uint64_t start = timers::Default::now();
+			ping(2 * defaults::warmup, rounds);
+			const uint64_t cycles = timers::Default::now() - start;
+			go_wait_end();
+
+			const CpuPair & cpus = cpuPair();
+			const topology::CpuInfo a = topology::cpuInfo(cpus.first);
+			const topology::CpuInfo b = topology::cpuInfo(cpus.second);
+			timing_callback(threadNum, Timings(PingPongData {
+						cpus.first, cpus.second, topology::relation(a, b), rounds, cycles
+						}));
+		}
+		else {
+			pong(0, defaults::warmup + rounds);
+			go_wait_end();
+		}
+	}
+
+	// the pair is the outer dimension, the (fixed) number of threads the inner
+	void PingPong::next() {
+		ThreadedBenchmark::next();
+		if (ThreadedBenchmark::atMin())
+			pair.next();
+	}
+
+	bool PingPong::atMin() const {
+		return ThreadedBenchmark::atMin() && pair.atMin();
+	}
+
+	bool PingPong::atMax() const {
+		return ThreadedBenchmark::atMax() && pair.atMax();
+	}
+
+	void PingPong::gotoBegin() {
+		ThreadedBenchmark::gotoBegin();
+		pair.gotoBegin();
+	}
+
+	void PingPong::gotoEnd() {
+		ThreadedBenchmark::gotoEnd();
+		pair.gotoEnd();
+	}
+
+	bool PingPong::operator==(const PingPong & rhs) const {
+		return static_cast<const ThreadedBenchmark &>(*this) == rhs
+			&& pair == rhs.pair;
+	}
+
+	bool PingPong::operator!=(const PingPong & rhs) const {
+		return !operator==(rhs);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../benchmark.hpp"
+#include "../memory.hpp"
+#include "timings.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace c2c {
+
+	namespace defaults {
+		static constexpr uint64_t rounds = 1 << 14;
+		// untimed round trips before measuring, to settle frequencies and let the
+		// line reach its steady state
+		static constexpr uint64_t warmup = 1 << 10;
+	}
+
+	// cpus of a ping-pong: the first one's thread first touches the line
+	using CpuPair = std::pair<unsigned, unsigned>;
+
+	// Cache line ping-pong between two threads pinned to cpuA resp. cpuB: the
+	// threads take turns incrementing a counter in a single line, each waiting
+	// for the other's increment before writing its own. Every round trip thus
+	// moves ownership of the line from one core to the other and back, so the
+	// round trip time is twice the core to core transfer latency (plus the
+	// polling overhead). The line is first touched by the thread on cpuA.
+	// The pair is a sweep dimension: every run measures the current pair of
+	// 'pairs', the same two pool threads re-pinning to it in ready().
+	class PingPong: public adhd::ThreadedBenchmark {
+		public:
+			PingPong(const std::vector<CpuPair> & pairs, uint64_t rounds = defaults::rounds);
+			PingPong(unsigned cpuA, unsigned cpuB, uint64_t rounds = defaults::rounds);
+
+			virtual PingPong * clone() const final override;
+
+			virtual void init(unsigned threadNum) final override;
+			virtual void ready(unsigned threadNum) final override;
+			virtual void go(unsigned threadNum) final override;
+
+			virtual void next() final override;
+
+			virtual bool atMin() const final override;
+			virtual bool atMax() const final override;
+			virtual void gotoBegin() final override;
+			virtual void gotoEnd() final override;
+
+			bool operator==(const PingPong &) const;
+			bool operator!=(const PingPong &) const;
+
+			inline const CpuPair & cpuPair() const { return pairs[pair.getValue()]; }
+
+		protected:
+			virtual adhd::Timings * makeRecord(unsigned threadNum) const final override;
+
+		private:
+			const std::vector<CpuPair> pairs;
+			// index of the current pair
+			adhd::AffineStepper<size_t> pair;
+			const uint64_t rounds;
+			adhd::PageMemory linemem;
+			std::atomic<uint64_t> * flag;
+
+			// bounce the line 'n' times, starting from counter value 'first'
+			void ping(uint64_t first, uint64_t n);
+			void pong(uint64_t first, uint64_t n);
+	};
+}
@@ -0,0 +1,54 @@
+#include "timings.hpp"
+
+#include "../prettyprint.hpp"
+#include "../timers.hpp"
+
+#include <iostream>
+
+using namespace prettyprint;
+using namespace std;
+
+/* see arraywalk_threaded/timings.cpp */
+#ifdef __INTEL_COMPILER
+#pragma warning(disable:869)
+#endif
+
+namespace c2c {
+
+	Timings::Timings(const PingPongData & _pd):
+		pd(_pd)
+	{}
+
+	Timings * Timings::clone() const { return new Timings(*this); }
+
+	bool Timings::assign(const adhd::Timings & other) {
+		const Timings * const t = dynamic_cast<const Timings *>(&other);
+		if (!t)
+			return false;
+		*this = *t;
+		return true;
+	}
+
+	ostream & Timings::formatHeader(ostream & out) const {
+		out << "cpu a, cpu b, relation, round trips, ticks, ns" << endl;
+		return out;
+	}
+
+	ostream & Timings::formatCSV(ostream & out) const {
+		return sequence(out, pd.cpuA, pd.cpuB, pd.relation, pd.roundtrips, pd.cycles,
+				adhd::timers::Default::ns(pd.cycles));
+	}
+
+	ostream & Timings::formatHuman(ostream & out) const {
+		const double roundtrip = (double) pd.cycles / (double) pd.roundtrips;
+		out << "cpu " << pd.cpuA << " <-> cpu " << pd.cpuB << " (" << pd.relation << ")"
+			<< " | " << pd.roundtrips << " round trips" << endl;
+		const double roundtripNs = adhd::timers::Default::ns(pd.cycles) / (double) pd.roundtrips;
+		out << "~ticks per round trip: " << roundtrip
+			<< " (one way: " << roundtrip / 2 << ")"
+			<< " | ~ns per round trip: " << roundtripNs
+			<< " (one way: " << roundtripNs / 2 << ")" << endl;
+		return out;
+	}
+
+}
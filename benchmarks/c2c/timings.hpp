@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../benchmark.hpp"
+#include "../topology.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace c2c {
+
+	struct PingPongData {
+		unsigned cpuA;
+		unsigned cpuB;
+		adhd::topology::Relation relation;
+		uint64_t roundtrips;
+		// timer ticks (see adhd::timers), not core cycles
+		uint64_t cycles;
+	};
+	static_assert(std::is_pod<PingPongData>::value, "struct PingPongData must be a POD");
+
+	class Timings: public adhd::Timings {
+		public:
+			Timings(const PingPongData & pd);
+			virtual Timings * clone() const override;
+			virtual bool assign(const adhd::Timings & other) override;
+			virtual std::ostream & formatHeader(std::ostream & out) const override;
+			virtual std::ostream & formatCSV(std::ostream & out) const override;
+			virtual std::ostream & formatHuman(std::ostream & out) const override;
+
+			inline const PingPongData & data() const { return pd; }
+
+		private:
+			PingPongData pd;
+	};
+
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace adhd {
+
+	// Counter-based random number generator: the SplitMix64 finalizer applied
+	// to a per-stream key and a counter. Any number of a stream can be computed
+	// without computing its predecessors, and distinct keys yield independent
+	// streams, so generation can be split freely over threads.
+	class CounterRNG {
+		public:
+			CounterRNG(uint64_t _key, uint64_t _counter = 0):
+				key(mix(_key)), counter(_counter) {}
+
+			inline uint64_t operator()() {
+				return mix(key + GOLDEN * ++counter);
+			}
+
+			// uniformly distributed in [0, bound), using a multiply-shift instead of
+			// a (much slower) division
+			inline uint64_t below(uint64_t bound) {
+				return static_cast<uint64_t>(
+						(static_cast<__uint128_t>((*this)()) * bound) >> 64);
+			}
+
+			static inline uint64_t mix(uint64_t z) {
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+				return z ^ (z >> 31);
+			}
+
+		private:
+			static constexpr uint64_t GOLDEN = 0x9e3779b97f4a7c15ULL;
+			uint64_t key;
+			uint64_t counter;
+	};
+
+	// Builds a random access pattern that is a single cycle through all nodes of
+	// an array, node i being located at array[i * stride] and holding the array
+	// index of the node visited after i.
+	//
+	// Generation is split into 'parts' interleaved classes of whole cache lines:
+	// the nodes sharing a line form a group, and group g belongs to class
+	// g % parts, so that no two classes write the same line (assuming a line
+	// aligned array of power of two sized nodes). generate() turns a class into
+	// a random cycle of its own using Sattolo's algorithm, independently of the
+	// other classes so that all classes can be generated concurrently. stitch()
+	// then joins the class cycles in random order into the final cycle, by
+	// swapping the successors of one element of each class. Classes span the
+	// whole array, so the pattern still hops randomly across the whole array.
+	template <typename INDEX_T>
+		class CycleGenerator {
+			public:
+				CycleGenerator(INDEX_T * _array, size_t _nodes, size_t _stride,
+						unsigned _parts, uint64_t _seed):
+					array(_array),
+					nodes(_nodes),
+					stride(_stride),
+					groupShift(lineShift(_stride * sizeof(INDEX_T))),
+					parts(clampParts(_parts, (_nodes + (size_t(1) << groupShift) - 1) >> groupShift)),
+					seed(_seed)
+				{}
+
+				inline unsigned numParts() const { return parts; }
+
+				// may run concurrently for distinct parts
+				void generate(unsigned part) {
+					if (part >= parts)
+						return;
+
+					const size_t group = size_t(1) << groupShift;
+					const size_t groups = (nodes + group - 1) >> groupShift;
+					const size_t owned = (groups - part + parts - 1) / parts;
+					size_t members = owned << groupShift;
+					// the last group may be short
+					if (part + (owned - 1) * parts == groups - 1)
+						members -= (groups << groupShift) - nodes;
+					CounterRNG rng(seed + part + 1);
+
+					// initialization encodes index as values
+					for (size_t k = 0; k < members; ++k) {
+						const size_t i = node(part, k) * stride;
+						array[i] = static_cast<INDEX_T>(i);
+					}
+
+					// Sattolo: swapping with a strictly preceding member only yields a
+					// single cycle through all members
+					for (size_t k = members - 1; k > 0; --k) {
+						const size_t r = static_cast<size_t>(rng.below(k));
+						std::swap(array[node(part, k) * stride], array[node(part, r) * stride]);
+					}
+				}
+
+				// join all generated parts into a single cycle
+				void stitch() {
+					if (parts < 2)
+						return;
+					CounterRNG rng(seed);
+					std::vector<unsigned> order(parts);
+					for (unsigned p = 0; p < parts; ++p)
+						order[p] = p;
+					for (unsigned p = parts - 1; p > 0; --p)
+						std::swap(order[p], order[rng.below(p + 1)]);
+
+					// swapping the successors of elements on distinct cycles merges them;
+					// the first node of class p is the first one of group p
+					const size_t first = stride << groupShift;
+					for (unsigned p = 1; p < parts; ++p)
+						std::swap(array[order[0] * first], array[order[p] * first]);
+				}
+
+			private:
+				static constexpr size_t LINE_SIZE = 64;
+
+				// log2 of the number of nodes per cache line, at least one
+				static unsigned lineShift(size_t nodeBytes) {
+					unsigned shift = 0;
+					while ((nodeBytes << (shift + 1)) <= LINE_SIZE)
+						++shift;
+					return shift;
+				}
+
+				static unsigned clampParts(unsigned wanted, size_t groups) {
+					return wanted < groups ? wanted : static_cast<unsigned>(groups);
+				}
+
+				// the k-th node of a class
+				inline size_t node(unsigned part, size_t k) const {
+					const size_t mask = (size_t(1) << groupShift) - 1;
+					return ((((k >> groupShift) * parts + part) << groupShift) | (k & mask));
+				}
+
+				INDEX_T * const array;
+				const size_t nodes;
+				const size_t stride;
+				const unsigned groupShift;
+				const unsigned parts;
+				const uint64_t seed;
+		};
+
+	// Single cycle visiting blocks of 'block' consecutive nodes one after the
+	// other, and the nodes inside each block in random order. Every block is
+	// entered through its first node, so blocks are generated independently.
+	// link(from, to) makes node 'from' point to node 'to'.
+	template <typename LINK>
+		void blockCycle(size_t nodes, size_t block, uint64_t seed, LINK link) {
+			std::vector<size_t> order;
+			for (size_t first = 0; first < nodes; first += block) {
+				const size_t members = std::min(block, nodes - first);
+				order.resize(members);
+				for (size_t k = 0; k < members; ++k)
+					order[k] = first + k;
+
+				// shuffle all but the entry node
+				CounterRNG rng(seed, first);
+				for (size_t k = members - 1; k > 1; --k)
+					std::swap(order[k], order[1 + rng.below(k)]);
+
+				for (size_t k = 0; k + 1 < members; ++k)
+					link(order[k], order[k + 1]);
+				link(order[members - 1], first + members < nodes ? first + members : 0);
+			}
+		}
+
+	// single random cycle through all nodes, for layouts CycleGenerator can not
+	// address directly
+	template <typename LINK>
+		void randomCycle(size_t nodes, uint64_t seed, LINK link) {
+			std::vector<size_t> next(nodes);
+			// a single part is a complete cycle, no stitching required
+			CycleGenerator<size_t> cycle(next.data(), nodes, 1, 1, seed);
+			cycle.generate(0);
+			for (size_t node = 0; node < nodes; ++node)
+				link(node, next[node]);
+		}
+}
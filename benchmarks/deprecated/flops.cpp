@@ -1,9 +1,9 @@
 #include "flops.hpp"
 
-#include <errno.h>
+#include "../memory.hpp"
+
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 
 static void fvec_init(int len, float * vec) {
 	int idx;
@@ -19,27 +19,31 @@ static void dvec_init(int len, double * vec) {
 		vec[idx] = init;
 }
 
+// the arena of the array freed last, reused by the next one made (e.g. for the
+// next length) so that its pages are faulted only once
+static adhd::Arena * spare = NULL;
+
 // aligned allocation to prevent crossing cache line boundaries for data that
 // fits on a single cache line
 static void allocFlopsArray(struct FlopsArray * array) {
 	size_t align;
-	void * data, * scale, * offset;
+	void ** data, ** scale, ** offset;
 
 	array->size = (size_t)array->len;
 	switch (array->precision) {
 		case SINGLE:
 			array->size *= sizeof(float);
 			align = __alignof(float);
-			data = &(array->vec.sp.data);
-			scale = &(array->vec.sp.scale);
-			offset = &(array->vec.sp.offset);
+			data = reinterpret_cast<void **>(&(array->vec.sp.data));
+			scale = reinterpret_cast<void **>(&(array->vec.sp.scale));
+			offset = reinterpret_cast<void **>(&(array->vec.sp.offset));
 			break;
 		case DOUBLE:
 			array->size *= sizeof(double);
 			align = __alignof(double);
-			data = &(array->vec.dp.data);
-			scale = &(array->vec.dp.scale);
-			offset = &(array->vec.dp.offset);
+			data = reinterpret_cast<void **>(&(array->vec.dp.data));
+			scale = reinterpret_cast<void **>(&(array->vec.dp.scale));
+			offset = reinterpret_cast<void **>(&(array->vec.dp.offset));
 			break;
 		default:
 			fprintf(stderr,
@@ -51,13 +55,18 @@ static void allocFlopsArray(struct FlopsArray * array) {
 	if (align < sizeof(void*))
 		align = sizeof(void*);
 
-	int ret;
-	if (0 != (ret = posix_memalign(&data, align, array->size)))
-		fprintf(stderr, "data memory allocation failed: %s\n", strerror(ret));
-	if (0 != (ret = posix_memalign(&scale, align, array->size)))
-		fprintf(stderr, "scale memory allocation failed: %s\n", strerror(ret));
-	if (0 != (ret = posix_memalign(&offset, align, array->size)))
-		fprintf(stderr, "offset memory allocation failed: %s\n", strerror(ret));
+	// all three vectors from one arena, faulted in before they are initialized
+	const size_t page = adhd::pageSize(adhd::PageBacking::SMALL);
+	array->mem = spare ? spare : new adhd::Arena();
+	spare = NULL;
+	array->mem->reserve(3 * (array->size + page), align, adhd::PageBacking::SMALL);
+	array->mem->reset();
+	*data = array->mem->window(array->size, align, adhd::PageBacking::SMALL);
+	*scale = array->mem->window(array->size, align, adhd::PageBacking::SMALL);
+	*offset = array->mem->window(array->size, align, adhd::PageBacking::SMALL);
+	array->mem->populate(*data, array->size);
+	array->mem->populate(*scale, array->size);
+	array->mem->populate(*offset, array->size);
 
 	switch (array->precision) {
 		case SINGLE:
@@ -86,18 +95,8 @@ void makeFlopsArray(
 }
 
 void freeFlopsArray(struct FlopsArray * array) {
-	switch (array->precision) {
-		case SINGLE:
-			free(array->vec.sp.data);
-			free(array->vec.sp.scale);
-			free(array->vec.sp.offset);
-			break;
-		case DOUBLE:
-			free(array->vec.dp.data);
-			free(array->vec.dp.scale);
-			free(array->vec.dp.offset);
-			break;
-	}
+	delete spare;
+	spare = array->mem;
 	free(array);
 }
 
@@ -2,6 +2,8 @@
 
 #include <stddef.h>
 
+namespace adhd { class Arena; }
+
 enum floating_t {SINGLE, DOUBLE};
 enum flop_t {ADD,MUL,MADD};
 
@@ -21,6 +23,8 @@ struct FlopsArray {
 			double * offset;
 		} dp;
 	} vec;
+	// the vectors are windows of it
+	adhd::Arena * mem;
 };
 
 void makeFlopsArray(
@@ -1,5 +1,7 @@
 #include "streaming.hpp"
 
+#include "../memory.hpp"
+
 #include <limits.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -30,34 +32,38 @@ static void initStreamArray(struct StreamArray * array) {
 	}
 }
 
+// the arena of the array freed last, reused by the next one made (e.g. for the
+// next size) so that its pages are faulted only once
+static adhd::Arena * spare = NULL;
+
 static void allocStreamArray(struct StreamArray * array) {
 	array->size = array->len;
 	unsigned align;
-	void * in, * out;
+	void ** in, ** out;
 	switch (array->width) {
 		case I8:
 			array->size *= sizeof(int8_t);
 			align = __alignof(int8_t);
-			in = &(array->in.i8);
-			out = &(array->out.i8);
+			in = reinterpret_cast<void **>(&(array->in.i8));
+			out = reinterpret_cast<void **>(&(array->out.i8));
 			break;
 		case I16:
 			array->size *= sizeof(int16_t);
 			align = __alignof(int16_t);
-			in = &(array->in.i16);
-			out = &(array->out.i16);
+			in = reinterpret_cast<void **>(&(array->in.i16));
+			out = reinterpret_cast<void **>(&(array->out.i16));
 			break;
 		case I32:
 			array->size *= sizeof(int32_t);
 			align = __alignof(int32_t);
-			in = &(array->in.i32);
-			out = &(array->out.i32);
+			in = reinterpret_cast<void **>(&(array->in.i32));
+			out = reinterpret_cast<void **>(&(array->out.i32));
 			break;
 		case I64:
 			array->size *= sizeof(int64_t);
 			align = __alignof(int64_t);
-			in = &(array->in.i64);
-			out = &(array->out.i64);
+			in = reinterpret_cast<void **>(&(array->in.i64));
+			out = reinterpret_cast<void **>(&(array->out.i64));
 			break;
 		default:
 			fprintf(stderr,
@@ -66,8 +72,16 @@ static void allocStreamArray(struct StreamArray * array) {
 			exit(EXIT_FAILURE);
 	}
 
-	posix_memalign(&in, align, array->size);
-	posix_memalign(&out, align, array->size);
+	// both arrays from one arena, faulted in before streaming through them
+	const size_t page = adhd::pageSize(adhd::PageBacking::SMALL);
+	array->mem = spare ? spare : new adhd::Arena();
+	spare = NULL;
+	array->mem->reserve(2 * (array->size + page), align, adhd::PageBacking::SMALL);
+	array->mem->reset();
+	*in = array->mem->window(array->size, align, adhd::PageBacking::SMALL);
+	*out = array->mem->window(array->size, align, adhd::PageBacking::SMALL);
+	array->mem->populate(*in, array->size);
+	array->mem->populate(*out, array->size);
 
 	initStreamArray(array);
 }
@@ -86,24 +100,8 @@ void makeStreamArray(
 }
 
 void freeStreamArray(struct StreamArray * array) {
-	switch (array->width) {
-		case I8:
-			free(array->in.i8);
-			free(array->out.i8);
-			break;
-		case I16:
-			free(array->in.i16);
-			free(array->out.i16);
-			break;
-		case I32:
-			free(array->in.i32);
-			free(array->out.i32);
-			break;
-		case I64:
-			free(array->in.i64);
-			free(array->out.i64);
-			break;
-	}
+	delete spare;
+	spare = array->mem;
 	free(array);
 }
 
@@ -3,6 +3,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+namespace adhd { class Arena; }
+
 enum stream_width {I8, I16, I32, I64};
 
 typedef union {
@@ -18,6 +20,8 @@ struct StreamArray {
 	size_t size;
 	array_t in;
 	array_t out;
+	// in and out are windows of it
+	adhd::Arena * mem;
 };
 
 void makeStreamArray(
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace adhd {
+	namespace hwcounters {
+		// event codes, see hwcounters.hpp
+		using enum_t = int;
+	}
+
+	// How to count more events than there are hardware counters:
+	// PASSES    - run the measured code once per list of events that fit in the
+	//             counters, and report the counts of all runs with the last one
+	// MULTIPLEX - count all events in a single run, time-sharing the counters;
+	//             the counts are extrapolated from the part of the run every
+	//             event was actually counted, as only perf_event reports it
+	enum class Scheduling { PASSES, MULTIPLEX };
+
+	inline std::ostream & operator<<(std::ostream & os, const Scheduling & s) {
+		const char * str;
+		switch (s) {
+			case Scheduling::PASSES: str = "passes"; break;
+			case Scheduling::MULTIPLEX: str = "multiplex"; break;
+			default: str = "<unknown>"; break;
+		}
+		return os << str;
+	}
+
+	// Hardware event counts accompanying a measurement, in the order the events
+	// were counted; empty when no events are counted.
+	struct EventCounts {
+		std::vector<hwcounters::enum_t> events;
+		std::vector<const char *> names;
+		std::vector<long long> values;
+		// the part of its run an event was counted; below 1 when multiplexed
+		std::vector<double> coverage;
+		// runs of the measured code the counts were gathered over
+		unsigned passes;
+
+		// counts sampled while counting, see ThreadedBenchmark::sampleEvents():
+		// the time since counting started (ns) and the pass of every sample,
+		// oldest first, and per sample the increase of every event since the
+		// previous sample of its pass, -1 for the events the pass does not count
+		struct Sample {
+			uint64_t ns;
+			unsigned pass;
+		};
+		std::vector<Sample> samples;
+		std::vector<long long> deltas;
+		// the earliest samples, overwritten in a full ring
+		uint64_t dropped;
+
+		inline bool empty() const { return values.empty(); }
+
+		// the least coverage of all events
+		double minCoverage() const {
+			double least = 1;
+			for (const auto c: coverage)
+				least = c < least ? c : least;
+			return least;
+		}
+
+		// continue a CSV header resp. line with a column per event, and the
+		// passes and least coverage of the counts
+		std::ostream & formatHeader(std::ostream & out) const {
+			for (const auto name: names)
+				out << ", " << name;
+			if (!empty())
+				out << ", counter passes, counter coverage";
+			return out;
+		}
+
+		std::ostream & formatCSV(std::ostream & out) const {
+			for (const auto value: values)
+				out << "," << value;
+			if (!empty())
+				out << "," << passes << "," << minCoverage();
+			return out;
+		}
+
+		// a line of counts, and counts per operation (e.g. per read)
+		std::ostream & formatHuman(std::ostream & out, uint64_t ops) const {
+			for (size_t e = 0; e < values.size(); ++e)
+				out << (e ? " | " : "") << names[e] << ": " << values[e]
+					<< " (" << (double) values[e] / (double) ops << ")";
+			if (passes > 1)
+				out << " | over " << passes << " runs";
+			if (minCoverage() < 1)
+				out << " | multiplexed, " << minCoverage() * 100 << "% coverage";
+			if (!samples.empty())
+				out << " | " << samples.size() << " samples";
+			if (dropped)
+				out << " (" << dropped << " earlier ones dropped)";
+			return out << std::endl;
+		}
+
+		// continue a CSV header resp. a line per sample, each starting with row
+		std::ostream & formatSeriesHeader(std::ostream & out) const {
+			out << "sample, pass, ns";
+			for (const auto name: names)
+				out << ", " << name;
+			return out << std::endl;
+		}
+
+		std::ostream & formatSeries(std::ostream & out, const std::string & row) const {
+			for (size_t s = 0; s < samples.size(); ++s) {
+				out << row << dropped + s << "," << samples[s].pass << "," << samples[s].ns;
+				for (size_t e = 0; e < values.size(); ++e) {
+					const long long delta = deltas[s * values.size() + e];
+					out << ",";
+					if (delta >= 0)
+						out << delta;
+				}
+				out << std::endl;
+			}
+			return out;
+		}
+	};
+
+}
@@ -0,0 +1,279 @@
+#include "hierarchy.hpp"
+
+#include "numa.hpp"
+#include "prettyprint.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace prettyprint;
+using namespace std;
+
+namespace adhd {
+
+	static const char CPU_ROOT[] = "/sys/devices/system/cpu/";
+
+	// sysfs sizes read like "32K", "2048K" or "8M"
+	static size_t parseSize(const string & str) {
+		stringstream ss(str);
+		size_t size = 0;
+		char unit = 0;
+		ss >> size >> unit;
+		switch (unit) {
+			case 'K': return size << 10;
+			case 'M': return size << 20;
+			case 'G': return size << 30;
+			default: return size;
+		}
+	}
+
+	template <typename T>
+		static bool readValue(const string & path, T & value) {
+			ifstream sysfs(path);
+			return static_cast<bool>(sysfs >> value);
+		}
+
+	vector<CacheInfo> sysfsCaches(unsigned cpu) {
+		vector<CacheInfo> caches;
+		for (unsigned index = 0; ; ++index) {
+			stringstream dir;
+			dir << CPU_ROOT << "cpu" << cpu << "/cache/index" << index << "/";
+
+			CacheInfo ci { 0, "", 0, 0, 0, {} };
+			string size, shared;
+			if (!readValue(dir.str() + "level", ci.level))
+				break;
+			readValue(dir.str() + "type", ci.type);
+			if ("Instruction" == ci.type)
+				continue;
+			if (readValue(dir.str() + "size", size))
+				ci.size = parseSize(size);
+			readValue(dir.str() + "coherency_line_size", ci.lineSize);
+			readValue(dir.str() + "ways_of_associativity", ci.ways);
+			if (readValue(dir.str() + "shared_cpu_list", shared))
+				ci.sharedCpus = numa::parseList(shared);
+			caches.push_back(ci);
+		}
+		sort(caches.begin(), caches.end(),
+				[] (const CacheInfo & a, const CacheInfo & b) { return a.level < b.level; });
+		return caches;
+	}
+
+	// plateaus spanning less than this factor in size may be transitions
+	static constexpr double TRANSITION_SPAN = 1.5;
+
+	// two-sided 95% quantiles of Student's t distribution, by degrees of freedom
+	static double tQuantile(size_t df) {
+		static const double table[] = {
+			0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228
+		};
+		if (df < sizeof(table) / sizeof(table[0]))
+			return table[df];
+		return df < 30 ? 2.1 : 1.96;
+	}
+
+	HierarchyFit::HierarchyFit(double _minStep):
+		minStep(_minStep),
+		samples()
+	{}
+
+	void HierarchyFit::add(size_t bytes, double latency) {
+		if (latency > 0)
+			samples.push_back(Sample { bytes, latency });
+	}
+
+	Plateau HierarchyFit::plateau(const vector<Sample> & sorted,
+			size_t first, size_t last) const {
+		const size_t n = last - first;
+		double sum = 0, sumsq = 0;
+		for (size_t i = first; i < last; ++i) {
+			sum += sorted[i].latency;
+			sumsq += sorted[i].latency * sorted[i].latency;
+		}
+		const double mean = sum / (double) n;
+		const double var = n > 1 ?
+			max(0.0, (sumsq - sum * mean) / (double) (n - 1)) : 0.0;
+		const double half = n > 1 ? tQuantile(n - 1) * sqrt(var / (double) n) : 0.0;
+
+		return Plateau {
+			sorted[first].bytes, sorted[last - 1].bytes, sorted[last - 1].bytes, 0,
+			n, mean, mean - half, mean + half
+		};
+	}
+
+	vector<Plateau> HierarchyFit::fit() const {
+		vector<Plateau> result;
+		if (samples.empty())
+			return result;
+
+		vector<Sample> sorted(samples);
+		sort(sorted.begin(), sorted.end(),
+				[] (const Sample & a, const Sample & b) { return a.bytes < b.bytes; });
+		const size_t n = sorted.size();
+
+		// latency does not decrease with the working set size: remove inversions
+		// due to noise by isotonic regression (pool adjacent violators) of the log
+		// latency, and segment the result
+		vector<double> fitted;
+		vector<size_t> weight;
+		for (size_t i = 0; i < n; ++i) {
+			fitted.push_back(log(sorted[i].latency));
+			weight.push_back(1);
+			while (fitted.size() > 1 && fitted[fitted.size() - 2] > fitted.back()) {
+				const size_t w = weight.back();
+				const double y = fitted.back();
+				fitted.pop_back();
+				weight.pop_back();
+				fitted.back() = (fitted.back() * (double) weight.back() + y * (double) w)
+					/ (double) (weight.back() + w);
+				weight.back() += w;
+			}
+		}
+
+		// prefix sums of the fitted log latency for constant time segment costs
+		vector<double> s1(n + 1, 0), s2(n + 1, 0);
+		for (size_t block = 0, i = 0; block < fitted.size(); ++block)
+			for (size_t k = 0; k < weight[block]; ++k, ++i) {
+				const double y = fitted[block];
+				s1[i + 1] = s1[i] + y;
+				s2[i + 1] = s2[i] + y * y;
+			}
+		auto sse = [&s1, &s2] (size_t a, size_t b) {
+			const double d = s1[b] - s1[a];
+			return s2[b] - s2[a] - d * d / (double) (b - a);
+		};
+		// segments only start and end between distinct sizes
+		auto isCut = [&sorted, n] (size_t b) {
+			return 0 == b || n == b || sorted[b - 1].bytes != sorted[b].bytes;
+		};
+
+		// noise estimate: successive samples mostly lie on the same plateau, so
+		// the median of their squared differences is robust against the knees
+		vector<double> diffs;
+		for (size_t i = 1; i < n; ++i) {
+			const double d = log(sorted[i].latency) - log(sorted[i - 1].latency);
+			diffs.push_back(d * d / 2);
+		}
+		double noise = log(1.05) * log(1.05);
+		if (!diffs.empty()) {
+			nth_element(diffs.begin(), diffs.begin() + diffs.size() / 2, diffs.end());
+			noise = max(noise, diffs[diffs.size() / 2]);
+		}
+		const double penalty = 2 * noise * log((double) n + 1);
+
+		// segmented least squares: best[b] is the cost of fitting sorted[0, b)
+		vector<double> best(n + 1, 0);
+		vector<size_t> prev(n + 1, 0);
+		for (size_t b = 1; b <= n; ++b) {
+			if (!isCut(b))
+				continue;
+			best[b] = HUGE_VAL;
+			for (size_t a = 0; a < b; ++a) {
+				if (!isCut(a))
+					continue;
+				const double cost = best[a] + sse(a, b) + penalty;
+				if (cost < best[b]) {
+					best[b] = cost;
+					prev[b] = a;
+				}
+			}
+		}
+		vector<size_t> bounds;
+		for (size_t b = n; b > 0; b = prev[b])
+			bounds.push_back(b);
+		bounds.push_back(0);
+		reverse(bounds.begin(), bounds.end());
+
+		// merge adjacent plateaus that are too close to be distinct levels
+		auto level = [&s1, &bounds] (size_t seg) {
+			return (s1[bounds[seg + 1]] - s1[bounds[seg]])
+				/ (double) (bounds[seg + 1] - bounds[seg]);
+		};
+		const double step = log(1 + minStep);
+		while (bounds.size() > 2) {
+			size_t closest = 0;
+			for (size_t seg = 1; seg + 2 < bounds.size(); ++seg)
+				if (fabs(level(seg + 1) - level(seg)) < fabs(level(closest + 1) - level(closest)))
+					closest = seg;
+			if (fabs(level(closest + 1) - level(closest)) >= step)
+				break;
+			bounds.erase(bounds.begin() + (ptrdiff_t) closest + 1);
+		}
+
+		// a narrow range of sizes in between its neighbours is part of a
+		// transition (e.g. a refined sweep sampling a knee densely)
+		const size_t segments = bounds.size() - 1;
+		for (size_t seg = 0; seg < segments; ++seg) {
+			const double first = (double) sorted[bounds[seg]].bytes;
+			const double last = (double) sorted[bounds[seg + 1] - 1].bytes;
+			if (last < TRANSITION_SPAN * first && seg > 0 && seg + 1 < segments
+					&& level(seg - 1) < level(seg) && level(seg) < level(seg + 1))
+				continue;
+			result.push_back(plateau(sorted, bounds[seg], bounds[seg + 1]));
+		}
+		for (size_t i = 0; i + 1 < result.size(); ++i)
+			result[i].capacityHigh = result[i + 1].firstSize;
+		return result;
+	}
+
+	ostream & HierarchyFit::report(ostream & out, const vector<CacheInfo> & caches) const {
+		const vector<Plateau> levels = fit();
+		size_t largest = 0, cacheLevels = 0;
+		for (const auto & ci: caches) {
+			largest = max(largest, ci.size);
+			cacheLevels = max<size_t>(cacheLevels, ci.level);
+		}
+
+		const auto flags = out.flags();
+		out << left << setw(8) << "level" << setw(24) << "capacity"
+			<< setw(28) << "latency (95% CI) ticks" << "sysfs" << endl;
+
+		for (size_t i = 0; i < levels.size(); ++i) {
+			const Plateau & p = levels[i];
+			// the last plateau is memory when it lies beyond all caches, or when
+			// there are more plateaus than cache levels
+			const bool memory = i + 1 == levels.size() && i > 0
+				&& ((largest && p.firstSize > largest) || i >= cacheLevels);
+
+			stringstream name, capacity, latency;
+			if (memory)
+				name << "memory";
+			else
+				name << "L" << i + 1;
+			if (p.capacityHigh)
+				capacity << Bytes(p.capacityLow) << " - " << Bytes(p.capacityHigh);
+			else
+				capacity << "> " << Bytes(p.capacityLow);
+			latency << fixed << setprecision(1) << p.latency
+				<< " [" << p.latencyLow << ", " << p.latencyHigh << "]";
+			out << setw(8) << name.str() << setw(24) << capacity.str()
+				<< setw(28) << latency.str();
+
+			// the effective capacity of a cache is somewhat smaller than its size,
+			// and sampling may be coarse: allow for a factor of two
+			const CacheInfo * ci = NULL;
+			for (const auto & c: caches)
+				if (c.level == i + 1) {
+					ci = &c;
+					break;
+				}
+			if (ci && !memory) {
+				const bool consistent = 2 * ci->size >= p.capacityLow
+					&& (0 == p.capacityHigh || ci->size <= 2 * p.capacityHigh);
+				out << Bytes(ci->size) << (consistent ? " (consistent)" : " (MISMATCH)");
+			}
+			else
+				out << "-";
+			out << endl;
+		}
+
+		if (levels.size() != cacheLevels + 1)
+			out << "note: " << levels.size() << " levels detected, sysfs describes "
+				<< cacheLevels << " cache levels plus memory" << endl;
+		out.flags(flags);
+		return out;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace adhd {
+
+	// cache description as reported by the kernel in
+	// /sys/devices/system/cpu/cpuN/cache/indexM
+	struct CacheInfo {
+		unsigned level;
+		std::string type; // Data, Instruction or Unified
+		size_t size;
+		size_t lineSize;
+		unsigned ways;
+		std::vector<unsigned> sharedCpus;
+	};
+
+	// data and unified caches of a cpu, sorted by level (empty when sysfs does
+	// not describe the caches)
+	std::vector<CacheInfo> sysfsCaches(unsigned cpu = 0);
+
+	// A level of the memory hierarchy as detected from a latency curve: a range
+	// of working set sizes with (approximately) constant access latency. The
+	// capacity of the level lies between the largest size sampled on the
+	// plateau and the smallest size sampled on the next one; capacityHigh is 0
+	// for the last plateau, whose capacity lies beyond the sampled range.
+	struct Plateau {
+		size_t firstSize;
+		size_t lastSize;
+		size_t capacityLow;
+		size_t capacityHigh;
+		size_t samples;
+		double latency;
+		// 95% confidence interval of the mean latency
+		double latencyLow;
+		double latencyHigh;
+	};
+
+	// Infers the levels of the memory hierarchy from (working set size, latency)
+	// samples, e.g. a pointer chase size sweep: after smoothing out noise by
+	// isotonic regression (latency does not decrease with size), a piecewise
+	// constant function is fitted to the log latency by segmented least squares,
+	// penalizing every plateau by the sample noise. Adjacent plateaus that differ
+	// by less than 'minStep' (relative) are merged, and narrow plateaus in
+	// between two others are considered part of the transition.
+	class HierarchyFit {
+		public:
+			HierarchyFit(double minStep = 0.15);
+
+			void add(size_t bytes, double latency);
+			inline size_t size() const { return samples.size(); }
+
+			std::vector<Plateau> fit() const;
+
+			// detected levels, cross-checked against the cache sizes in sysfs
+			std::ostream & report(std::ostream & out,
+					const std::vector<CacheInfo> & caches = sysfsCaches()) const;
+
+		private:
+			struct Sample {
+				size_t bytes;
+				double latency;
+			};
+
+			double minStep;
+			std::vector<Sample> samples;
+
+			Plateau plateau(const std::vector<Sample> & sorted,
+					size_t first, size_t last) const;
+	};
+}
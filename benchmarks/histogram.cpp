@@ -0,0 +1,73 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace adhd {
+
+	// exact buckets for [0, 2 * SUB_BUCKETS), then SUB_BUCKETS per power of two
+	// for the 64 - SUB_BITS - 1 remaining ones
+	static constexpr size_t EXACT = 2 * Histogram::SUB_BUCKETS;
+	static constexpr size_t BUCKETS = EXACT + (64 - Histogram::SUB_BITS - 1) * Histogram::SUB_BUCKETS;
+
+	Histogram::Histogram():
+		counts(BUCKETS, 0), total(0), minValue(numeric_limits<uint64_t>::max()),
+		maxValue(0), sum(0)
+	{}
+
+	size_t Histogram::bucket(uint64_t value) {
+		if (value < EXACT)
+			return static_cast<size_t>(value);
+		// value >> shift lies in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+		const unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(value));
+		const unsigned shift = msb - SUB_BITS;
+		return EXACT + (shift - 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+	}
+
+	uint64_t Histogram::highest(size_t b) {
+		if (b < EXACT)
+			return b;
+		const unsigned shift = static_cast<unsigned>((b - EXACT) / SUB_BUCKETS) + 1;
+		const uint64_t top = SUB_BUCKETS + (b - EXACT) % SUB_BUCKETS;
+		return ((top + 1) << shift) - 1;
+	}
+
+	void Histogram::add(uint64_t value) {
+		++counts[bucket(value)];
+		++total;
+		minValue = std::min(minValue, value);
+		maxValue = std::max(maxValue, value);
+		sum += static_cast<double>(value);
+	}
+
+	void Histogram::clear() {
+		fill(counts.begin(), counts.end(), 0);
+		total = 0;
+		minValue = numeric_limits<uint64_t>::max();
+		maxValue = 0;
+		sum = 0;
+	}
+
+	double Histogram::mean() const {
+		return total ? sum / static_cast<double>(total) : 0;
+	}
+
+	uint64_t Histogram::quantile(double q) const {
+		if (0 == total)
+			return 0;
+		// rank of the value at q, counting from 1
+		const uint64_t rank = std::max<uint64_t>(1,
+				static_cast<uint64_t>(ceil(q * static_cast<double>(total))));
+		uint64_t seen = 0;
+		for (size_t b = 0; b < counts.size(); ++b) {
+			seen += counts[b];
+			if (seen >= rank)
+				return std::min(highest(b), maxValue);
+		}
+		return maxValue;
+	}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace adhd {
+
+	// Log-linear histogram of unsigned values, in the spirit of HdrHistogram:
+	// values below 2 * SUB_BUCKETS are counted exactly, larger ones in
+	// SUB_BUCKETS buckets per power of two, i.e. with a relative error below
+	// 1 / SUB_BUCKETS. Covers the full uint64_t range in under a thousand
+	// buckets, so folding in samples never allocates.
+	class Histogram {
+		public:
+			static constexpr unsigned SUB_BITS = 4;
+			static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BITS;
+
+			Histogram();
+
+			void add(uint64_t value);
+			void clear();
+
+			inline uint64_t count() const { return total; }
+			inline uint64_t min() const { return total ? minValue : 0; }
+			inline uint64_t max() const { return maxValue; }
+			double mean() const;
+
+			// highest value equivalent to the value at quantile q (0 <= q <= 1),
+			// i.e. an upper bound on the value at q within the bucket precision
+			uint64_t quantile(double q) const;
+
+		private:
+			std::vector<uint64_t> counts;
+			uint64_t total;
+			uint64_t minValue;
+			uint64_t maxValue;
+			double sum;
+
+			static size_t bucket(uint64_t value);
+			static uint64_t highest(size_t bucket);
+	};
+
+}
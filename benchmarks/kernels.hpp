@@ -0,0 +1,415 @@
+#pragma once
+
+#include "timers.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <stdexcept>
+
+// Measurement kernels shared by the benchmarks, unrolled at compile time over
+// a number of independent instruction streams: kernel<N> keeps N independent
+// indices or accumulators, so up to N memory accesses can be in flight at the
+// same time. All streams live in a local array that is only ever indexed with
+// constants, which allows the compiler to keep them in registers (as far as
+// the architecture has registers to spare: x86-64 only has 16 general purpose
+// registers, so wide kernels spill to the stack).
+// Kernels read the clock through the TIMER policy (see timers.hpp), which
+// defaults to timers::Default.
+namespace adhd {
+	namespace kernels {
+
+		static constexpr unsigned MAX_STREAMS = 64;
+		// prefetching kernels keep an index and a shadow path position per stream,
+		// and spill to the stack much earlier: only instantiate the narrower ones
+		static constexpr unsigned MAX_PREFETCH_STREAMS = 16;
+		// likewise for the updating kernels, which carry a value per stream
+		static constexpr unsigned MAX_UPDATE_STREAMS = 16;
+		// and for the sampling kernels, of which only few streams make sense
+		static constexpr unsigned MAX_SAMPLED_STREAMS = 16;
+
+		// compile-time sequence 0, 1, ..., N - 1 (std::index_sequence is C++14)
+		template <size_t... I> struct indices {};
+		template <size_t N, size_t... I>
+			struct make_indices: make_indices<N - 1, N - 1, I...> {};
+		template <size_t... I>
+			struct make_indices<0, I...> { typedef indices<I...> type; };
+
+		// evaluates a pack expansion in order, for its side effects
+		typedef int expand[];
+
+		template <typename T>
+			inline T sum(T t) { return t; }
+		template <typename T, typename... R>
+			inline T sum(T t, R... r) { return static_cast<T>(t + sum(r...)); }
+
+		static const char STREAMS_RANGE[] =
+			"Number of instruction streams is not between 1 and 64.";
+		static const char PREFETCH_STREAMS_RANGE[] =
+			"Number of prefetching instruction streams is not between 1 and 16.";
+		static const char UPDATE_STREAMS_RANGE[] =
+			"Number of updating instruction streams is not between 1 and 16.";
+		static const char SAMPLED_STREAMS_RANGE[] =
+			"Number of sampling instruction streams is not between 1 and 16.";
+		static const char SAMPLE_EVERY_ZERO[] =
+			"Sampling interval must be at least one hop.";
+
+		// Pointer chase: every stream follows the cycle encoded in 'array', starting
+		// at array[start[k]], for MiB times the number of indices fitting in a MiB.
+		// Every hop also reads 'words' payload words following the index.
+		template <typename TIMER, typename INDEX_T, size_t... S>
+			INDEX_T chaseUnrolled(const INDEX_T * const array, const INDEX_T * const start,
+					const size_t words, const uint_fast32_t MiB,
+					uint64_t & cycles, uint64_t & reads, indices<S...>)
+			{
+				constexpr unsigned long mb_reads = (1 << 20) / sizeof(INDEX_T);
+				INDEX_T idx[sizeof...(S)] = { start[S]... };
+				INDEX_T paysum = 0;
+
+				reads = sizeof...(S) * MiB * mb_reads;
+				const uint64_t cStart = TIMER::now();
+				for (uint_fast32_t step = 0; step < MiB; ++step)
+					for (unsigned long i = 0; i < mb_reads; ++i) {
+						(void) expand { 0, ((void) (idx[S] = array[idx[S]]), 0)... };
+						for (size_t w = 1; w <= words; ++w)
+							paysum = static_cast<INDEX_T>(paysum + sum(array[idx[S] + w]...));
+					}
+				cycles = TIMER::now() - cStart;
+				return static_cast<INDEX_T>(paysum + sum(idx[S]...));
+			}
+
+		// Sampling pointer chase: as chaseUnrolled, but every 'every'-th hop (of all
+		// streams at once) is timed by itself, including its payload reads (which
+		// touch the node arrived at), its duration stored in 'samples',
+		// which holds room for MiB * (1 MiB / sizeof(INDEX_T)) / every values.
+		// Reading the timer is part of both the samples and the total cycles; see
+		// timers::overhead().
+		template <typename TIMER, typename INDEX_T, size_t... S>
+			INDEX_T chaseSampledUnrolled(const INDEX_T * const array, const INDEX_T * const start,
+					const size_t words, const uint_fast32_t MiB, const size_t every,
+					uint64_t * const samples, uint64_t & cycles, uint64_t & reads, indices<S...>)
+			{
+				constexpr unsigned long mb_reads = (1 << 20) / sizeof(INDEX_T);
+				INDEX_T idx[sizeof...(S)] = { start[S]... };
+				INDEX_T paysum = 0;
+				uint64_t * sample = samples;
+				size_t countdown = every;
+
+				reads = sizeof...(S) * MiB * mb_reads;
+				const uint64_t cStart = TIMER::now();
+				for (uint_fast32_t step = 0; step < MiB; ++step)
+					for (unsigned long i = 0; i < mb_reads; ++i) {
+						const bool timed = 0 == --countdown;
+						uint64_t hopStart = 0;
+						if (timed) {
+							countdown = every;
+							hopStart = TIMER::now();
+						}
+						(void) expand { 0, ((void) (idx[S] = array[idx[S]]), 0)... };
+						for (size_t w = 1; w <= words; ++w)
+							paysum = static_cast<INDEX_T>(paysum + sum(array[idx[S] + w]...));
+						if (timed)
+							*sample++ = TIMER::now() - hopStart;
+					}
+				cycles = TIMER::now() - cStart;
+				return static_cast<INDEX_T>(paysum + sum(idx[S]...));
+			}
+
+		// What every hop does with the payload of the node it arrives at:
+		// READ   - read it
+		// WRITE  - store the hop count in it
+		// SWAP   - exchange it with the value carried along from the previous node
+		// ATOMIC - atomically increment it (a locked read-modify-write on x86)
+		// All but READ leave the cache line of every node visited dirty, so
+		// walks beyond a cache level also pay for writing back evicted lines.
+		enum class Access { READ, WRITE, SWAP, ATOMIC };
+
+		inline std::ostream & operator<<(std::ostream & os, const Access & a) {
+			const char * str;
+			switch (a) {
+				case Access::READ: str = "read"; break;
+				case Access::WRITE: str = "write"; break;
+				case Access::SWAP: str = "swap"; break;
+				case Access::ATOMIC: str = "atomic"; break;
+				default: str = "<unknown>"; break;
+			}
+			return os << str;
+		}
+
+		// Updating pointer chase: as chaseUnrolled, but updating the 'words'
+		// payload words following the index of every node (see Access) instead of
+		// reading them. Concurrent walkers on the same array race on the payload,
+		// which is harmless: the links are never written.
+		template <typename TIMER, Access ACCESS, typename INDEX_T, size_t... S>
+			INDEX_T chaseUpdateUnrolled(INDEX_T * const array, const INDEX_T * const start,
+					const size_t words, const uint_fast32_t MiB,
+					uint64_t & cycles, uint64_t & reads, indices<S...>)
+			{
+				constexpr unsigned long mb_reads = (1 << 20) / sizeof(INDEX_T);
+				INDEX_T idx[sizeof...(S)] = { start[S]... };
+				INDEX_T carry[sizeof...(S)] = {};
+				INDEX_T hop = 0;
+
+				reads = sizeof...(S) * MiB * mb_reads;
+				const uint64_t cStart = TIMER::now();
+				for (uint_fast32_t step = 0; step < MiB; ++step)
+					for (unsigned long i = 0; i < mb_reads; ++i) {
+						(void) expand { 0, ((void) (idx[S] = array[idx[S]]), 0)... };
+						++hop;
+						for (size_t w = 1; w <= words; ++w)
+							switch (ACCESS) {
+								case Access::WRITE:
+									(void) expand { 0, ((void) (array[idx[S] + w] = hop), 0)... };
+									break;
+								case Access::SWAP:
+									(void) expand { 0, ((void) std::swap(array[idx[S] + w], carry[S]), 0)... };
+									break;
+								case Access::ATOMIC:
+									(void) expand { 0, ((void) __atomic_fetch_add(
+												array + idx[S] + w, 1, __ATOMIC_RELAXED), 0)... };
+									break;
+								default:
+									break;
+							}
+					}
+				cycles = TIMER::now() - cStart;
+				return static_cast<INDEX_T>(sum(carry[S]...) + sum(idx[S]...));
+			}
+
+		// Software prefetch hints, from all cache levels (T0) down to not
+		// polluting the caches (NTA), see __builtin_prefetch.
+		enum class Prefetch { T0, T1, T2, NTA };
+
+		inline std::ostream & operator<<(std::ostream & os, const Prefetch & p) {
+			const char * str;
+			switch (p) {
+				case Prefetch::T0: str = "T0"; break;
+				case Prefetch::T1: str = "T1"; break;
+				case Prefetch::T2: str = "T2"; break;
+				case Prefetch::NTA: str = "NTA"; break;
+				default: str = "<unknown>"; break;
+			}
+			return os << str;
+		}
+
+		// Prefetching pointer chase: as chaseUnrolled, but every hop also prefetches
+		// the node 'distance' hops ahead of each stream. The addresses come from
+		// 'shadow', the cycle in visiting order ('hops' nodes), followed by a copy
+		// of its first 'distance' nodes; stream k starts at position pos[k]. The
+		// shadow path is read sequentially, so its cost is (mostly) bandwidth.
+		template <typename TIMER, int LOCALITY, typename INDEX_T, size_t... S>
+			INDEX_T chasePrefetchUnrolled(const INDEX_T * const array,
+					const INDEX_T * const start, const INDEX_T * const shadow,
+					const size_t * const pos, const size_t hops, const size_t distance,
+					const size_t words, const uint_fast32_t MiB,
+					uint64_t & cycles, uint64_t & reads, indices<S...>)
+			{
+				constexpr unsigned long mb_reads = (1 << 20) / sizeof(INDEX_T);
+				const INDEX_T * const ahead = shadow + distance;
+				INDEX_T idx[sizeof...(S)] = { start[S]... };
+				size_t at[sizeof...(S)] = { pos[S]... };
+				INDEX_T paysum = 0;
+
+				reads = sizeof...(S) * MiB * mb_reads;
+				const uint64_t cStart = TIMER::now();
+				for (uint_fast32_t step = 0; step < MiB; ++step)
+					for (unsigned long i = 0; i < mb_reads; ++i) {
+						(void) expand { 0, ((void) (idx[S] = array[idx[S]]), 0)... };
+						(void) expand { 0, ((void) (at[S] = at[S] + 1 == hops ? 0 : at[S] + 1), 0)... };
+						(void) expand { 0, ((void) __builtin_prefetch(array + ahead[at[S]], 0, LOCALITY), 0)... };
+						for (size_t w = 1; w <= words; ++w)
+							paysum = static_cast<INDEX_T>(paysum + sum(array[idx[S] + w]...));
+					}
+				cycles = TIMER::now() - cStart;
+				return static_cast<INDEX_T>(paysum + sum(idx[S]...));
+			}
+
+		// Reduction: the array is split in as many parts as there are streams,
+		// each stream summing its own part, for MiB times a MiB of reads.
+		template <typename TIMER, typename INDEX_T, size_t... S>
+			INDEX_T reduceUnrolled(const INDEX_T * const array, const size_t length,
+					const uint_fast32_t MiB, uint64_t & cycles, indices<S...>)
+			{
+				constexpr unsigned long mb_reads = (1 << 20) / sizeof(INDEX_T);
+				const unsigned long array_reads = mb_reads / length;
+				const size_t part = length / sizeof...(S);
+				const INDEX_T * const arr[sizeof...(S)] = { (array + part * S)... };
+				INDEX_T acc[sizeof...(S)] = {};
+
+				const uint64_t cStart = TIMER::now();
+				for (uint_fast32_t step = 0; step < MiB; ++step)
+					for (unsigned long ar = 0; ar < array_reads; ++ar)
+						for (size_t i = 0; i < part; ++i)
+							(void) expand {
+								0, ((void) (acc[S] = static_cast<INDEX_T>(acc[S] + arr[S][i])), 0)...
+							};
+				cycles = TIMER::now() - cStart;
+				return sum(acc[S]...);
+			}
+
+		template <typename INDEX_T>
+			using chase_fn = INDEX_T (*)(const INDEX_T *, const INDEX_T *, size_t,
+					uint_fast32_t, uint64_t &, uint64_t &);
+		template <typename INDEX_T>
+			using chase_sampled_fn = INDEX_T (*)(const INDEX_T *, const INDEX_T *, size_t,
+					uint_fast32_t, size_t, uint64_t *, uint64_t &, uint64_t &);
+		template <typename INDEX_T>
+			using chase_update_fn = INDEX_T (*)(INDEX_T *, const INDEX_T *, size_t,
+					uint_fast32_t, uint64_t &, uint64_t &);
+		template <typename INDEX_T>
+			using chase_prefetch_fn = INDEX_T (*)(const INDEX_T *, const INDEX_T *,
+					const INDEX_T *, const size_t *, size_t, size_t, size_t,
+					uint_fast32_t, uint64_t &, uint64_t &);
+		template <typename INDEX_T>
+			using reduce_fn = INDEX_T (*)(const INDEX_T *, size_t, uint_fast32_t, uint64_t &);
+
+		template <typename TIMER, typename INDEX_T, unsigned N>
+			INDEX_T chaseN(const INDEX_T * array, const INDEX_T * start, size_t words,
+					uint_fast32_t MiB, uint64_t & cycles, uint64_t & reads) {
+				return chaseUnrolled<TIMER>(array, start, words, MiB, cycles, reads,
+						typename make_indices<N>::type());
+			}
+
+		template <typename TIMER, typename INDEX_T, unsigned N>
+			INDEX_T chaseSampledN(const INDEX_T * array, const INDEX_T * start, size_t words,
+					uint_fast32_t MiB, size_t every, uint64_t * samples,
+					uint64_t & cycles, uint64_t & reads) {
+				return chaseSampledUnrolled<TIMER>(array, start, words, MiB, every, samples,
+						cycles, reads, typename make_indices<N>::type());
+			}
+
+		template <typename TIMER, Access ACCESS, typename INDEX_T, unsigned N>
+			INDEX_T chaseUpdateN(INDEX_T * array, const INDEX_T * start, size_t words,
+					uint_fast32_t MiB, uint64_t & cycles, uint64_t & reads) {
+				return chaseUpdateUnrolled<TIMER, ACCESS>(array, start, words, MiB, cycles, reads,
+						typename make_indices<N>::type());
+			}
+
+		template <typename TIMER, int LOCALITY, typename INDEX_T, unsigned N>
+			INDEX_T chasePrefetchN(const INDEX_T * array, const INDEX_T * start,
+					const INDEX_T * shadow, const size_t * pos, size_t hops, size_t distance,
+					size_t words, uint_fast32_t MiB, uint64_t & cycles, uint64_t & reads) {
+				return chasePrefetchUnrolled<TIMER, LOCALITY>(array, start, shadow, pos, hops,
+						distance, words, MiB, cycles, reads, typename make_indices<N>::type());
+			}
+
+		template <typename TIMER, typename INDEX_T, unsigned N>
+			INDEX_T reduceN(const INDEX_T * array, size_t length, uint_fast32_t MiB,
+					uint64_t & cycles) {
+				return reduceUnrolled<TIMER>(array, length, MiB, cycles,
+						typename make_indices<N>::type());
+			}
+
+		// dispatch tables, indexed by the number of streams minus one
+		template <typename TIMER, typename INDEX_T, size_t... I>
+			inline chase_fn<INDEX_T> chaseKernel(unsigned streams, indices<I...>) {
+				static constexpr chase_fn<INDEX_T> table[] = { &chaseN<TIMER, INDEX_T, I + 1>... };
+				return table[streams - 1];
+			}
+		template <typename TIMER, typename INDEX_T, size_t... I>
+			inline chase_sampled_fn<INDEX_T> chaseSampledKernel(unsigned streams,
+					indices<I...>) {
+				static constexpr chase_sampled_fn<INDEX_T> table[] = {
+					&chaseSampledN<TIMER, INDEX_T, I + 1>...
+				};
+				return table[streams - 1];
+			}
+		template <typename TIMER, Access ACCESS, typename INDEX_T, size_t... I>
+			inline chase_update_fn<INDEX_T> chaseUpdateKernel(unsigned streams,
+					indices<I...>) {
+				static constexpr chase_update_fn<INDEX_T> table[] = {
+					&chaseUpdateN<TIMER, ACCESS, INDEX_T, I + 1>...
+				};
+				return table[streams - 1];
+			}
+		template <typename TIMER, int LOCALITY, typename INDEX_T, size_t... I>
+			inline chase_prefetch_fn<INDEX_T> chasePrefetchKernel(unsigned streams,
+					indices<I...>) {
+				static constexpr chase_prefetch_fn<INDEX_T> table[] = {
+					&chasePrefetchN<TIMER, LOCALITY, INDEX_T, I + 1>...
+				};
+				return table[streams - 1];
+			}
+		template <typename TIMER, typename INDEX_T, size_t... I>
+			inline reduce_fn<INDEX_T> reduceKernel(unsigned streams, indices<I...>) {
+				static constexpr reduce_fn<INDEX_T> table[] = { &reduceN<TIMER, INDEX_T, I + 1>... };
+				return table[streams - 1];
+			}
+
+		// run the kernel with 'streams' streams; start holds a starting index for
+		// each of them; another timer is chosen as in chase<timers::Rdtscp>(...)
+		template <typename TIMER = timers::Default, typename INDEX_T>
+			INDEX_T chase(unsigned streams, const INDEX_T * array, const INDEX_T * start,
+					size_t words, uint_fast32_t MiB, uint64_t & cycles, uint64_t & reads) {
+				if (streams < 1 || streams > MAX_STREAMS)
+					throw std::out_of_range(STREAMS_RANGE);
+				return chaseKernel<TIMER, INDEX_T>(streams, make_indices<MAX_STREAMS>::type())(
+						array, start, words, MiB, cycles, reads);
+			}
+
+		// as chase, timing every 'every'-th hop into samples (see
+		// chaseSampledUnrolled)
+		template <typename TIMER = timers::Default, typename INDEX_T>
+			INDEX_T chaseSampled(unsigned streams, const INDEX_T * array,
+					const INDEX_T * start, size_t words, uint_fast32_t MiB, size_t every,
+					uint64_t * samples, uint64_t & cycles, uint64_t & reads) {
+				if (streams < 1 || streams > MAX_SAMPLED_STREAMS)
+					throw std::out_of_range(SAMPLED_STREAMS_RANGE);
+				if (0 == every)
+					throw std::domain_error(SAMPLE_EVERY_ZERO);
+				return chaseSampledKernel<TIMER, INDEX_T>(streams,
+						make_indices<MAX_SAMPLED_STREAMS>::type())(
+						array, start, words, MiB, every, samples, cycles, reads);
+			}
+
+		// as chase, accessing the payload as given (see Access)
+		template <typename TIMER = timers::Default, typename INDEX_T>
+			INDEX_T chase(unsigned streams, Access access, INDEX_T * array,
+					const INDEX_T * start, size_t words, uint_fast32_t MiB,
+					uint64_t & cycles, uint64_t & reads) {
+				if (Access::READ == access)
+					return chase<TIMER>(streams, array, start, words, MiB, cycles, reads);
+				if (streams < 1 || streams > MAX_UPDATE_STREAMS)
+					throw std::out_of_range(UPDATE_STREAMS_RANGE);
+				const auto all = make_indices<MAX_UPDATE_STREAMS>::type();
+				chase_update_fn<INDEX_T> kernel;
+				switch (access) {
+					case Access::WRITE: kernel = chaseUpdateKernel<TIMER, Access::WRITE, INDEX_T>(streams, all); break;
+					case Access::SWAP: kernel = chaseUpdateKernel<TIMER, Access::SWAP, INDEX_T>(streams, all); break;
+					default: kernel = chaseUpdateKernel<TIMER, Access::ATOMIC, INDEX_T>(streams, all); break;
+				}
+				return kernel(array, start, words, MiB, cycles, reads);
+			}
+
+		// as chase, prefetching 'distance' hops ahead along the shadow path using
+		// the given hint (see chasePrefetchUnrolled)
+		template <typename TIMER = timers::Default, typename INDEX_T>
+			INDEX_T chasePrefetch(unsigned streams, Prefetch hint, const INDEX_T * array,
+					const INDEX_T * start, const INDEX_T * shadow, const size_t * pos,
+					size_t hops, size_t distance, size_t words, uint_fast32_t MiB,
+					uint64_t & cycles, uint64_t & reads) {
+				if (streams < 1 || streams > MAX_PREFETCH_STREAMS)
+					throw std::out_of_range(PREFETCH_STREAMS_RANGE);
+				const auto all = make_indices<MAX_PREFETCH_STREAMS>::type();
+				chase_prefetch_fn<INDEX_T> kernel;
+				switch (hint) {
+					case Prefetch::T1: kernel = chasePrefetchKernel<TIMER, 2, INDEX_T>(streams, all); break;
+					case Prefetch::T2: kernel = chasePrefetchKernel<TIMER, 1, INDEX_T>(streams, all); break;
+					case Prefetch::NTA: kernel = chasePrefetchKernel<TIMER, 0, INDEX_T>(streams, all); break;
+					default: kernel = chasePrefetchKernel<TIMER, 3, INDEX_T>(streams, all); break;
+				}
+				return kernel(array, start, shadow, pos, hops, distance, words, MiB,
+						cycles, reads);
+			}
+
+		template <typename TIMER = timers::Default, typename INDEX_T>
+			INDEX_T reduce(unsigned streams, const INDEX_T * array, size_t length,
+					uint_fast32_t MiB, uint64_t & cycles) {
+				if (streams < 1 || streams > MAX_STREAMS)
+					throw std::out_of_range(STREAMS_RANGE);
+				return reduceKernel<TIMER, INDEX_T>(streams, make_indices<MAX_STREAMS>::type())(
+						array, length, MiB, cycles);
+			}
+	}
+}
@@ -20,6 +20,8 @@ class PhonyTimings: public Timings {
 		PhonyTimings(long long unsigned _start, long long unsigned _stop):
 			start(_start), stop(_stop) {}
 
+		virtual PhonyTimings * clone() const override { return new PhonyTimings(*this); }
+
 		virtual ostream & formatHeader(ostream & out) const override {
 			return out << "PhonyHeader" << endl;
 		}
@@ -63,6 +65,11 @@ class SpreadTimings: public Timings {
 			ul.unlock();
 		}
 
+		// the mutex is not copied along
+		virtual SpreadTimings * clone() const override {
+			return new SpreadTimings(threads, min, max);
+		}
+
 		virtual ostream & formatHeader(ostream & out) const override {
 			return out << "SpreadHeader" << endl;
 		}
@@ -157,7 +164,7 @@ class TestThreaded: public ThreadedBenchmark, public RangeSet<AffineStepper<unsi
 		}
 #else
 		// loop inversion as proof of concept
-		// (slower because more threads are being created in total)
+		// (as fast: the thread pool outlives changes to the number of threads)
 		virtual void next() final override {
 			ThreadedBenchmark::next();
 			if (ThreadedBenchmark::atMin())
@@ -218,8 +225,13 @@ ostream & operator<<(ostream & os, const Count & c) {
 int main(int argc, char * argv[]) {
 	// hwcounters - start cache profile of main
 	const Events events {
+#ifdef ADHD_PAPI
 		hwcounters::cache::L1::DCA,
 			hwcounters::cache::L1::DCH,
+#else
+		// no generic perf_event counts all accesses or hits
+		hwcounters::cache::L1::DCR,
+#endif
 			hwcounters::cache::L1::DCM,
 	};
 	auto ctrs = PerfStat(events);
@@ -0,0 +1,218 @@
+#include "memory.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// not all C libraries expose the hugetlb size selection flags
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+// Linux 5.14
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+using namespace std;
+
+namespace adhd {
+
+	// Arena windows must be aligned to a power of two.
+	static const char NOT_POW2_ALIGN[] =
+		"Requested window alignment is not a power of two.";
+
+	// Windows after the first one since Arena::reset() must fit into the
+	// reservation, as growing it would move the windows handed out before.
+	static const char ARENA_EXHAUSTED[] =
+		"Arena window does not fit into the reserved address space.";
+
+	ostream & operator<<(ostream & os, const PageBacking & pb) {
+		const char * str;
+		switch (pb) {
+			case PageBacking::SMALL: str = "small"; break;
+			case PageBacking::TRANSPARENT: str = "THP"; break;
+			case PageBacking::HUGE_2M: str = "2M"; break;
+			case PageBacking::HUGE_1G: str = "1G"; break;
+			default: str = "<unknown>"; break;
+		}
+		return os << str;
+	}
+
+	size_t pageSize(PageBacking pb) {
+		switch (pb) {
+			case PageBacking::TRANSPARENT:
+			case PageBacking::HUGE_2M:
+				return size_t(1) << 21;
+			case PageBacking::HUGE_1G:
+				return size_t(1) << 30;
+			case PageBacking::SMALL:
+			default:
+				return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		}
+	}
+
+	// madvise(MADV_HUGEPAGE) succeeds even when THP is administratively
+	// disabled, so consult sysfs before trusting it
+	static bool thpEnabled() {
+		ifstream sysfs("/sys/kernel/mm/transparent_hugepage/enabled");
+		string setting;
+		if (!getline(sysfs, setting))
+			return false;
+		return string::npos == setting.find("[never]");
+	}
+
+	static inline size_t roundUp(size_t value, size_t multiple) {
+		return (value + multiple - 1) & ~(multiple - 1);
+	}
+
+	PageMemory::PageMemory():
+		base(NULL),
+		length(0),
+		obtained(PageBacking::SMALL)
+	{}
+
+	PageMemory::~PageMemory() { unmap(); }
+
+	void PageMemory::unmap() {
+		if (NULL != base)
+			munmap(base, length);
+		base = NULL;
+		length = 0;
+	}
+
+	void * PageMemory::map(size_t bytes, size_t align, PageBacking requested) {
+		// fall back from the requested backing to progressively smaller pages
+		static const PageBacking order[] = {
+			PageBacking::HUGE_1G,
+			PageBacking::HUGE_2M,
+			PageBacking::TRANSPARENT,
+			PageBacking::SMALL
+		};
+
+		unmap();
+		bool eligible = false;
+		for (const auto pb: order) {
+			eligible = eligible || pb == requested;
+			if (eligible && tryMap(bytes, align, pb))
+				return base;
+		}
+		throw system_error(errno, generic_category(), strerror(errno));
+	}
+
+	bool PageMemory::tryMap(size_t bytes, size_t align, PageBacking pb) {
+		const bool hugetlb =
+			PageBacking::HUGE_2M == pb || PageBacking::HUGE_1G == pb;
+
+		if (PageBacking::TRANSPARENT == pb && !thpEnabled())
+			return false;
+
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+		if (PageBacking::HUGE_2M == pb)
+			flags |= MAP_HUGETLB | MAP_HUGE_2MB;
+		if (PageBacking::HUGE_1G == pb)
+			flags |= MAP_HUGETLB | MAP_HUGE_1GB;
+
+		// mmap guarantees alignment to the mapping's own page size; any stricter
+		// alignment is obtained by mapping some slack and trimming it afterwards,
+		// so that no memory remains over-allocated
+		const size_t page = pageSize(pb);
+		const size_t granule = hugetlb ? page : pageSize(PageBacking::SMALL);
+		const size_t alignment = align > page ? align : page;
+		const size_t len = roundUp(bytes, page);
+		const size_t slack = alignment - granule;
+
+		void * const raw = mmap(NULL, len + slack, PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (MAP_FAILED == raw)
+			return false;
+
+		const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+		const uintptr_t aligned = roundUp(start, alignment);
+		const size_t head = aligned - start;
+		const size_t tail = slack - head;
+		if (head)
+			munmap(raw, head);
+		if (tail)
+			munmap(reinterpret_cast<void *>(aligned + len), tail);
+
+		base = reinterpret_cast<void *>(aligned);
+		length = len;
+		obtained = pb;
+
+		if (PageBacking::TRANSPARENT == pb && madvise(base, length, MADV_HUGEPAGE)) {
+			unmap();
+			return false;
+		}
+		return true;
+	}
+
+	Arena::Arena():
+		mem(),
+		requested(PageBacking::SMALL),
+		alignment(0),
+		top(0)
+	{}
+
+	void Arena::reserve(size_t bytes, size_t align, PageBacking pb) {
+		if (NULL != mem.data() && pb == requested && bytes <= mem.size() && align <= alignment)
+			return;
+		// keep covering what was reserved before
+		if (NULL != mem.data() && pb == requested) {
+			bytes = bytes > mem.size() ? bytes : mem.size();
+			align = align > alignment ? align : alignment;
+		}
+		top = 0;
+		mem.map(bytes, align, pb);
+		requested = pb;
+		const size_t page = pageSize(mem.backing());
+		alignment = align > page ? align : page;
+	}
+
+	void * Arena::window(size_t bytes, size_t align, PageBacking pb) {
+		if (0 == align || 0 != (align & (align - 1)))
+			throw domain_error(NOT_POW2_ALIGN);
+		if (0 == top)
+			reserve(bytes, align, pb);
+		else if (pb != requested || align > alignment)
+			throw length_error(ARENA_EXHAUSTED);
+
+		// windows start on a page, so that they can be bound and populated
+		const size_t page = pageSize(mem.backing());
+		const size_t start = roundUp(top, align > page ? align : page);
+		const size_t end = start + roundUp(bytes, page);
+		if (end > mem.size())
+			throw length_error(ARENA_EXHAUSTED);
+		top = end;
+		return static_cast<char *>(mem.data()) + start;
+	}
+
+	void Arena::reset() { top = 0; }
+
+	void Arena::release() {
+		mem.unmap();
+		alignment = 0;
+		top = 0;
+	}
+
+	void Arena::populate(void * win, size_t bytes) const {
+		if (0 == bytes || 0 == madvise(win, bytes, MADV_POPULATE_WRITE))
+			return;
+		// older kernels: write every page, keeping its contents
+		const size_t page = pageSize(mem.backing());
+		volatile char * const p = static_cast<volatile char *>(win);
+		for (size_t off = 0; off < bytes; off += page)
+			p[off] = p[off];
+	}
+}
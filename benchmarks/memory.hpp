@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace adhd {
+
+	// Page size backing benchmark memory: SMALL uses the base page size (4 KiB
+	// on x86), TRANSPARENT requests transparent huge pages using madvise, and
+	// HUGE_2M resp. HUGE_1G map explicit huge pages from the hugetlbfs pool.
+	enum class PageBacking { SMALL, TRANSPARENT, HUGE_2M, HUGE_1G };
+
+	std::ostream & operator<<(std::ostream & os, const PageBacking & pb);
+
+	// size in bytes of one page of the given backing
+	size_t pageSize(PageBacking pb);
+
+	// Anonymous memory mapping backed by pages of a requested size. When the
+	// requested backing can not be provided (e.g. the hugetlbfs pool is empty or
+	// transparent huge pages are disabled), the next smaller backing is tried,
+	// down to SMALL pages; backing() reports what was actually obtained.
+	class PageMemory {
+		public:
+			PageMemory();
+			PageMemory(const PageMemory &) = delete;
+			PageMemory & operator=(const PageMemory &) = delete;
+			~PageMemory();
+
+			// release the current mapping (if any), and map at least 'bytes' bytes
+			// aligned to 'align', which must be a power of two
+			void * map(size_t bytes, size_t align, PageBacking requested);
+			void unmap();
+
+			inline void * data() const { return base; }
+			inline size_t size() const { return length; }
+			inline PageBacking backing() const { return obtained; }
+
+		private:
+			void * base;
+			size_t length;
+			PageBacking obtained;
+
+			bool tryMap(size_t bytes, size_t align, PageBacking pb);
+	};
+
+	// Address space for the arrays of a benchmark, reserved once and backed by
+	// pages of a requested size (see PageMemory). Arrays are carved out of it as
+	// windows, one after the other, each aligned as requested: the reservation
+	// is aligned to the largest alignment, so no window is over-allocated to be
+	// aligned. reset() hands the space out anew while its pages stay mapped, so
+	// that a sweep faults every page once instead of once per point, and
+	// populate() faults in the pages of a window before they are timed.
+	class Arena {
+		public:
+			Arena();
+			Arena(const Arena &) = delete;
+			Arena & operator=(const Arena &) = delete;
+
+			// reserve at least 'bytes' aligned to 'align' (a power of two), unless
+			// the reservation covers them already; reserving anew drops all
+			// windows and pages, so reserve for the largest window up front
+			void reserve(size_t bytes, size_t align, PageBacking requested);
+
+			// the next 'bytes' (rounded up to whole pages) aligned to 'align',
+			// which must be a power of two; the first window after reset() may
+			// grow the reservation, later ones must fit into it
+			void * window(size_t bytes, size_t align, PageBacking requested);
+
+			// all windows are free again, their pages stay mapped
+			void reset();
+			void release();
+
+			// fault in the pages of a window not faulted yet, after binding them
+			// to a NUMA node if at all (see numa::bind)
+			void populate(void * win, size_t bytes) const;
+
+			inline void * data() const { return mem.data(); }
+			inline size_t capacity() const { return mem.size(); }
+			// bytes handed out since reset(), alignment gaps included
+			inline size_t used() const { return top; }
+			inline PageBacking backing() const { return mem.backing(); }
+
+		private:
+			PageMemory mem;
+			PageBacking requested;
+			size_t alignment;
+			size_t top;
+	};
+
+	// Allocator honouring the alignment of T, e.g. for a std::vector of cache
+	// line aligned per-thread slots: before C++17, operator new does not align
+	// beyond the fundamental alignment.
+	template <typename T>
+		struct AlignedAllocator {
+			using value_type = T;
+
+			AlignedAllocator() = default;
+			template <typename U>
+				AlignedAllocator(const AlignedAllocator<U> &) {}
+
+			T * allocate(size_t n) {
+				void * p;
+				const size_t align = alignof(T) < sizeof(void *) ? sizeof(void *) : alignof(T);
+				if (posix_memalign(&p, align, n * sizeof(T)))
+					throw std::bad_alloc();
+				return static_cast<T *>(p);
+			}
+
+			void deallocate(T * p, size_t) { free(p); }
+		};
+
+	template <typename T, typename U>
+		inline bool operator==(const AlignedAllocator<T> &, const AlignedAllocator<U> &) { return true; }
+	template <typename T, typename U>
+		inline bool operator!=(const AlignedAllocator<T> &, const AlignedAllocator<U> &) { return false; }
+}
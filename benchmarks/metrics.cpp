@@ -0,0 +1,165 @@
+#include "metrics.hpp"
+
+#include "hierarchy.hpp"
+#include "hwcounters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace adhd {
+
+	namespace metrics {
+
+		// First pass thresholds: misses per 1000 instructions well beyond those
+		// of code running from the caches, a TLB miss every 100 operations, and
+		// traffic at 70% of the peak bandwidth
+		static constexpr double L1_MPKI = 50;
+		static constexpr double L2_MPKI = 20;
+		static constexpr double LLC_MPKI = 5;
+		static constexpr double TLB_PER_KILO_OPS = 10;
+		static constexpr double FRONTEND_MPKI = 5;
+		static constexpr double SATURATION = 0.7;
+		// when sysfs does not tell
+		static constexpr size_t LINE_SIZE = 64;
+		// the base event of metrics based on something else
+		static constexpr hwcounters::enum_t UNUSED = -1;
+
+		template <typename T>
+		static constexpr hwcounters::enum_t code(T event) {
+			return static_cast<hwcounters::enum_t>(event);
+		}
+
+		vector<Metric> standard() {
+			using namespace hwcounters;
+			using Base = Metric::Base;
+			// every last level cache miss moves a line from (or to) memory:
+			// bytes per ns are GB/s
+			const vector<CacheInfo> caches = sysfsCaches();
+			const double line = static_cast<double>(
+					caches.empty() || !caches.back().lineSize ? LINE_SIZE : caches.back().lineSize);
+			const enum_t INS = code(instructions::INS);
+			return {
+				{ "IPC", INS, Base::EVENT, code(instructions::CYC), 1, Bound::UNKNOWN, 0 },
+				{ "L1 MPKI", code(cache::L1::DCM), Base::EVENT, INS, 1000, Bound::LATENCY, L1_MPKI },
+				{ "L2 MPKI", code(cache::L2::DCM), Base::EVENT, INS, 1000, Bound::LATENCY, L2_MPKI },
+				{ "LLC MPKI", code(cache::L3::TCM), Base::EVENT, INS, 1000, Bound::LATENCY, LLC_MPKI },
+				{ "DTLB misses per 1000 ops", code(TLB::DM), Base::OPS, UNUSED, 1000,
+					Bound::LATENCY, TLB_PER_KILO_OPS },
+				{ "L1I MPKI", code(cache::L1::ICM), Base::EVENT, INS, 1000, Bound::FRONTEND,
+					FRONTEND_MPKI },
+				{ "branch MPKI", code(branching::MSP), Base::EVENT, INS, 1000, Bound::FRONTEND,
+					FRONTEND_MPKI },
+				{ "DRAM GB/s", code(cache::L3::TCM), Base::NS, UNUSED, line, Bound::BANDWIDTH,
+					SATURATION },
+			};
+		}
+
+		vector<Metric> available(const vector<Metric> & metrics) {
+			vector<Metric> known;
+			for (const auto & m: metrics)
+				if (PerfStat::available(m.event) &&
+						(Metric::Base::EVENT != m.base || PerfStat::available(m.per)))
+					known.push_back(m);
+			return known;
+		}
+
+		vector<hwcounters::enum_t> events(const vector<Metric> & metrics,
+				vector<hwcounters::enum_t> events)
+		{
+			const auto add = [&events] (hwcounters::enum_t e) {
+				if (find(events.begin(), events.end(), e) == events.end())
+					events.push_back(e);
+			};
+			for (const auto & m: metrics) {
+				add(m.event);
+				if (Metric::Base::EVENT == m.base)
+					add(m.per);
+			}
+			return events;
+		}
+
+		// NaN when the event was not counted
+		static double count(const EventCounts & ec, hwcounters::enum_t e) {
+			const auto pos = find(ec.events.begin(), ec.events.end(), e);
+			return pos == ec.events.end() ? numeric_limits<double>::quiet_NaN() :
+				static_cast<double>(ec.values[static_cast<size_t>(pos - ec.events.begin())]);
+		}
+
+		static double derive(const Metric & m, const EventCounts & ec, uint64_t ops, double ns) {
+			double base = ns;
+			if (Metric::Base::EVENT == m.base)
+				base = count(ec, m.per);
+			else if (Metric::Base::OPS == m.base)
+				base = static_cast<double>(ops);
+			const double value = m.scale * count(ec, m.event) / base;
+			return base > 0 ? value : numeric_limits<double>::quiet_NaN();
+		}
+
+		// of the bounds reached, the one diagnosed: the lowest
+		static unsigned precedence(Bound b) {
+			switch (b) {
+				case Bound::BANDWIDTH: return 0;
+				case Bound::LATENCY: return 1;
+				case Bound::FRONTEND: return 2;
+				default: return 3;
+			}
+		}
+	}
+
+	DerivedMetrics::DerivedMetrics():
+		names(), values(), bound(Bound::UNKNOWN)
+	{}
+
+	DerivedMetrics::DerivedMetrics(const vector<Metric> & metrics, const EventCounts & ec,
+			uint64_t ops, double ns, double peakBandwidth):
+		names(), values(), bound(Bound::UNKNOWN)
+	{
+		for (const auto & m: metrics) {
+			const double value = metrics::derive(m, ec, ops, ns);
+			names.push_back(m.name);
+			values.push_back(value);
+			if (std::isnan(value))
+				continue;
+			if (Bound::UNKNOWN == bound)
+				bound = Bound::CORE;
+			const double threshold = Bound::BANDWIDTH == m.indicates ?
+				m.threshold * peakBandwidth : m.threshold;
+			if (threshold > 0 && value >= threshold &&
+					metrics::precedence(m.indicates) < metrics::precedence(bound))
+				bound = m.indicates;
+		}
+	}
+
+	ostream & DerivedMetrics::formatHeader(ostream & out) const {
+		for (const auto name: names)
+			out << ", " << name;
+		if (!empty())
+			out << ", bound";
+		return out;
+	}
+
+	ostream & DerivedMetrics::formatCSV(ostream & out) const {
+		for (const auto value: values) {
+			out << ",";
+			if (!std::isnan(value))
+				out << value;
+		}
+		if (!empty())
+			out << "," << bound;
+		return out;
+	}
+
+	ostream & DerivedMetrics::formatHuman(ostream & out) const {
+		bool first = true;
+		for (size_t m = 0; m < values.size(); ++m)
+			if (!std::isnan(values[m])) {
+				out << (first ? "" : " | ") << names[m] << ": " << values[m];
+				first = false;
+			}
+		return out << (first ? "" : " | ") << bound << "-bound" << endl;
+	}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "eventcounts.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace adhd {
+
+	// What limits a measurement, as far as its derived metrics tell:
+	// LATENCY   - accesses missing the caches (or the TLB), waited for one by one
+	// BANDWIDTH - memory traffic close to the peak bandwidth
+	// FRONTEND  - instruction supply: instruction cache misses, mispredictions
+	// CORE      - none of the above, the execution itself
+	// UNKNOWN   - no metric to tell
+	enum class Bound { UNKNOWN, LATENCY, BANDWIDTH, FRONTEND, CORE };
+
+	inline std::ostream & operator<<(std::ostream & os, const Bound & b) {
+		const char * str;
+		switch (b) {
+			case Bound::UNKNOWN: str = "unknown"; break;
+			case Bound::LATENCY: str = "latency"; break;
+			case Bound::BANDWIDTH: str = "bandwidth"; break;
+			case Bound::FRONTEND: str = "frontend"; break;
+			case Bound::CORE: str = "core"; break;
+			default: str = "<unknown>"; break;
+		}
+		return os << str;
+	}
+
+	// A metric derived from a counted event: scale * event / base, the base
+	// being another event, the operations of the measurement (e.g. reads) or
+	// its duration in ns. Reaching its threshold, a metric points at a bound;
+	// the threshold of a BANDWIDTH metric is a fraction of the peak bandwidth.
+	struct Metric {
+		enum class Base { EVENT, OPS, NS };
+
+		const char * name;
+		hwcounters::enum_t event;
+		Base base;
+		// the base event, for Base::EVENT
+		hwcounters::enum_t per;
+		double scale;
+		Bound indicates;
+		double threshold;
+	};
+
+	namespace metrics {
+		// IPC, misses per 1000 instructions resp. operations and the DRAM
+		// bandwidth (GB/s), for a first diagnosis of what bounds a measurement
+		std::vector<Metric> standard();
+
+		// the metrics whose events the counting backend knows on this CPU
+		std::vector<Metric> available(const std::vector<Metric> & metrics);
+
+		// the events to count for the metrics: events, followed by the events
+		// the metrics need that are not among them yet
+		std::vector<hwcounters::enum_t> events(const std::vector<Metric> & metrics,
+				std::vector<hwcounters::enum_t> events = std::vector<hwcounters::enum_t>());
+	}
+
+	// Metrics derived from the event counts accompanying a measurement, and the
+	// bound they point at: BANDWIDTH before LATENCY before FRONTEND, CORE when
+	// none is reached. A metric is left out (NaN) when an event it needs was not
+	// counted or its base is 0; without a peak bandwidth (GB/s), BANDWIDTH is
+	// never diagnosed.
+	struct DerivedMetrics {
+		std::vector<const char *> names;
+		std::vector<double> values;
+		Bound bound;
+
+		DerivedMetrics();
+		DerivedMetrics(const std::vector<Metric> & metrics, const EventCounts & ec,
+				uint64_t ops, double ns, double peakBandwidth = 0);
+
+		inline bool empty() const { return names.empty(); }
+
+		// continue a CSV header resp. line with a column per metric and the bound
+		std::ostream & formatHeader(std::ostream & out) const;
+		std::ostream & formatCSV(std::ostream & out) const;
+		std::ostream & formatHuman(std::ostream & out) const;
+	};
+
+}
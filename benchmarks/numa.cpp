@@ -0,0 +1,148 @@
+#include "numa.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace adhd {
+	namespace numa {
+
+		static const char NODE_ROOT[] = "/sys/devices/system/node/";
+
+		// mbind takes a node mask of 'maxnode' bits; this bounds the node numbers
+		// this code can handle
+		static constexpr size_t MASK_WORDS = 16;
+		static constexpr size_t WORD_BITS = sizeof(unsigned long) * CHAR_BIT;
+
+		ostream & operator<<(ostream & os, const Placement & p) {
+			const char * str;
+			switch (p) {
+				case Placement::FIRST_TOUCH: str = "first-touch"; break;
+				case Placement::LOCAL: str = "local"; break;
+				case Placement::REMOTE: str = "remote"; break;
+				case Placement::INTERLEAVE: str = "interleave"; break;
+				default: str = "<unknown>"; break;
+			}
+			return os << str;
+		}
+
+		vector<unsigned> parseList(const string & list) {
+			vector<unsigned> result;
+			stringstream ss(list);
+			string range;
+			while (getline(ss, range, ',')) {
+				unsigned first, last;
+				char dash;
+				stringstream rs(range);
+				if (!(rs >> first))
+					continue;
+				last = first;
+				if (rs >> dash && '-' == dash)
+					rs >> last;
+				for (unsigned i = first; i <= last; ++i)
+					result.push_back(i);
+			}
+			return result;
+		}
+
+		static bool readList(const string & path, vector<unsigned> & result) {
+			ifstream sysfs(path);
+			string list;
+			if (!getline(sysfs, list))
+				return false;
+			result = parseList(list);
+			return true;
+		}
+
+		static vector<unsigned> nodeList(const char * name) {
+			vector<unsigned> result;
+			if (!readList(string(NODE_ROOT) + name, result) || result.empty())
+				result.assign(1, 0);
+			return result;
+		}
+
+		vector<unsigned> nodes() { return nodeList("online"); }
+		vector<unsigned> memoryNodes() { return nodeList("has_memory"); }
+		vector<unsigned> cpuNodes() { return nodeList("has_cpu"); }
+
+		vector<unsigned> nodeCpus(unsigned node) {
+			vector<unsigned> result;
+			stringstream path;
+			path << NODE_ROOT << "node" << node << "/cpulist";
+			if (!readList(path.str(), result)) {
+				// no NUMA support: every online cpu is local to node 0
+				if (0 != node)
+					throw invalid_argument("nodeCpus(): no such NUMA node");
+				readList("/sys/devices/system/cpu/online", result);
+			}
+			return result;
+		}
+
+		unsigned cpuNode(unsigned cpu) {
+			for (const auto node: nodes())
+				for (const auto c: nodeCpus(node))
+					if (c == cpu)
+						return node;
+			return 0;
+		}
+
+		unsigned currentNode() {
+			const int cpu = sched_getcpu();
+			if (cpu < 0)
+				throw system_error(errno, generic_category(), strerror(errno));
+			return cpuNode(static_cast<unsigned>(cpu));
+		}
+
+		void runOnNode(unsigned node) {
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			for (const auto cpu: nodeCpus(node))
+				CPU_SET(cpu, &cpuset);
+			const int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+			if (rc)
+				throw system_error(rc, generic_category(), strerror(rc));
+		}
+
+		void bind(void * addr, size_t len, Placement placement, unsigned node) {
+			unsigned long mask[MASK_WORDS] = {};
+			int mode;
+
+			switch (placement) {
+				case Placement::FIRST_TOUCH:
+					return;
+				case Placement::LOCAL:
+				case Placement::REMOTE:
+					mode = MPOL_BIND;
+					if (node >= MASK_WORDS * WORD_BITS)
+						throw out_of_range("bind(): NUMA node number too large");
+					mask[node / WORD_BITS] |= 1UL << (node % WORD_BITS);
+					break;
+				case Placement::INTERLEAVE:
+				default:
+					mode = MPOL_INTERLEAVE;
+					for (const auto n: memoryNodes())
+						if (n < MASK_WORDS * WORD_BITS)
+							mask[n / WORD_BITS] |= 1UL << (n % WORD_BITS);
+					break;
+			}
+
+			// no glibc wrapper: avoid depending on libnuma for a single syscall
+			const long rc = syscall(SYS_mbind, addr, len, mode, mask,
+					MASK_WORDS * WORD_BITS, MPOL_MF_MOVE);
+			if (rc)
+				throw system_error(errno, generic_category(), strerror(errno));
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace adhd {
+	namespace numa {
+
+		// Memory placement policies for benchmark memory:
+		// FIRST_TOUCH - default kernel policy: pages end up on the node of the
+		//               thread first writing them (whoever initializes the array)
+		// LOCAL       - bind to the node the walker runs on
+		// REMOTE      - bind to an explicitly requested node
+		// INTERLEAVE  - interleave pages over all nodes that have memory
+		enum class Placement { FIRST_TOUCH, LOCAL, REMOTE, INTERLEAVE };
+
+		std::ostream & operator<<(std::ostream & os, const Placement & p);
+
+		// parse the sysfs list format, e.g. "0-3,8,10-11"
+		std::vector<unsigned> parseList(const std::string & list);
+
+		// online nodes, and those of them that have memory resp. cpus attached
+		// (systems without NUMA support report a single node 0)
+		std::vector<unsigned> nodes();
+		std::vector<unsigned> memoryNodes();
+		std::vector<unsigned> cpuNodes();
+
+		// cpus local to a node, and the node a cpu belongs to
+		std::vector<unsigned> nodeCpus(unsigned node);
+		unsigned cpuNode(unsigned cpu);
+
+		// node the calling thread currently runs on
+		unsigned currentNode();
+
+		// restrict the calling thread to the cpus local to a node
+		void runOnNode(unsigned node);
+
+		// apply a placement policy to a (not yet touched) memory range; 'node' is
+		// the target node for LOCAL and REMOTE, and ignored otherwise
+		void bind(void * addr, size_t len, Placement placement, unsigned node);
+	}
+}
@@ -0,0 +1,484 @@
+#pragma once
+
+// PAPI backend of hwcounters.hpp: event codes are PAPI presets
+
+#include "hwcounters.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <papi.h>
+#include <pthread.h>
+
+namespace adhd {
+	namespace hwcounters {
+		namespace names {
+			constexpr const struct entry {
+				const enum_t key;
+				const char * const val;
+			}  mapping[] {
+				// Conditional Branching
+				{ PAPI_BR_CN, "Conditional branch instructions" },
+				{ PAPI_BR_INS, "Branch instructions" },
+				{ PAPI_BR_MSP, "Conditional branch instructions mispredicted" },
+				{ PAPI_BR_NTK, "Conditional branch instructions not taken" },
+				{ PAPI_BR_PRC, "Conditional branch instructions correctly predicted" },
+				{ PAPI_BR_TKN, "Conditional branch instructions taken" },
+				{ PAPI_BR_UCN, "Unconditional branch instructions" },
+				{ PAPI_BRU_IDL, "Cycles branch units are idle" },
+				{ PAPI_BTAC_M, "Branch target address cache misses" },
+
+				// Cache Requests:
+				{ PAPI_CA_CLN, "Requests for exclusive access to clean cache line" },
+				{ PAPI_CA_INV, "Requests for cache line invalidation" },
+				{ PAPI_CA_ITV, "Requests for cache line intervention" },
+				{ PAPI_CA_SHR, "Requests for exclusive access to shared cache line" },
+				{ PAPI_CA_SNP, "Requests for a snoop" },
+
+				// Conditional Store:
+				{ PAPI_CSR_FAL, "Failed store conditional instructions" },
+				{ PAPI_CSR_SUC, "Successful store conditional instructions" },
+				{ PAPI_CSR_TOT, "Total store conditional instructions" },
+
+				// Floating Point Operations:
+				{ PAPI_FAD_INS, "Floating point add instructions" },
+				{ PAPI_FDV_INS, "Floating point divide instructions" },
+				{ PAPI_FMA_INS, "FMA instructions completed" },
+				{ PAPI_FML_INS, "Floating point multiply instructions" },
+				{ PAPI_FNV_INS, "Floating point inverse instructions" },
+				{ PAPI_FP_INS, "Floating point instructions" },
+				{ PAPI_FP_OPS, "Floating point operations" },
+				{ PAPI_FP_STAL, "Cycles the FP unit" },
+				{ PAPI_FPU_IDL, "Cycles floating point units are idle" },
+				{ PAPI_FSQ_INS, "Floating point square root instructions" },
+				{ PAPI_SP_OPS, "Floating point operations executed; optimized to count scaled single precision vector operations" },
+				{ PAPI_DP_OPS, "Floating point operations executed; optimized to count scaled double precision vector operations" },
+				{ PAPI_VEC_SP, "Single precision vector/SIMD instructions" },
+				{ PAPI_VEC_DP, "Double precision vector/SIMD instructions" },
+
+				// Instruction Counting:
+				{ PAPI_FUL_CCY, "Cycles with maximum instructions completed" },
+				{ PAPI_FUL_ICY, "Cycles with maximum instruction issue" },
+				{ PAPI_FXU_IDL, "Cycles integer units are idle" },
+				{ PAPI_HW_INT, "Hardware interrupts" },
+				{ PAPI_INT_INS, "Integer instructions" },
+				{ PAPI_TOT_CYC, "Total cycles" },
+				{ PAPI_TOT_IIS, "Instructions issued" },
+				{ PAPI_TOT_INS, "Instructions completed" },
+				{ PAPI_VEC_INS, "Vector/SIMD instructions" },
+
+				// Cache Access:
+				{ PAPI_L1_DCA, "L1 data cache accesses" },
+				{ PAPI_L1_DCH, "L1 data cache hits" },
+				{ PAPI_L1_DCM, "L1 data cache misses" },
+				{ PAPI_L1_DCR, "L1 data cache reads" },
+				{ PAPI_L1_DCW, "L1 data cache writes" },
+				{ PAPI_L1_ICA, "L1 instruction cache accesses" },
+				{ PAPI_L1_ICH, "L1 instruction cache hits" },
+				{ PAPI_L1_ICM, "L1 instruction cache misses" },
+				{ PAPI_L1_ICR, "L1 instruction cache reads" },
+				{ PAPI_L1_ICW, "L1 instruction cache writes" },
+				{ PAPI_L1_LDM, "L1 load misses" },
+				{ PAPI_L1_STM, "L1 store misses" },
+				{ PAPI_L1_TCA, "L1 total cache accesses" },
+				{ PAPI_L1_TCH, "L1 total cache hits" },
+				{ PAPI_L1_TCM, "L1 total cache misses" },
+				{ PAPI_L1_TCR, "L1 total cache reads" },
+				{ PAPI_L1_TCW, "L1 total cache writes" },
+				{ PAPI_L2_DCA, "L2 data cache accesses" },
+				{ PAPI_L2_DCH, "L2 data cache hits" },
+				{ PAPI_L2_DCM, "L2 data cache misses" },
+				{ PAPI_L2_DCR, "L2 data cache reads" },
+				{ PAPI_L2_DCW, "L2 data cache writes" },
+				{ PAPI_L2_ICA, "L2 instruction cache accesses" },
+				{ PAPI_L2_ICH, "L2 instruction cache hits" },
+				{ PAPI_L2_ICM, "L2 instruction cache misses" },
+				{ PAPI_L2_ICR, "L2 instruction cache reads" },
+				{ PAPI_L2_ICW, "L2 instruction cache writes" },
+				{ PAPI_L2_LDM, "L2 load misses" },
+				{ PAPI_L2_STM, "L2 store misses" },
+				{ PAPI_L2_TCA, "L2 total cache accesses" },
+				{ PAPI_L2_TCH, "L2 total cache hits" },
+				{ PAPI_L2_TCM, "L2 total cache misses" },
+				{ PAPI_L2_TCR, "L2 total cache reads" },
+				{ PAPI_L2_TCW, "L2 total cache writes" },
+				{ PAPI_L3_DCA, "L3 data cache accesses" },
+				{ PAPI_L3_DCH, "L3 Data Cache Hits" },
+				{ PAPI_L3_DCM, "L3 data cache misses" },
+				{ PAPI_L3_DCR, "L3 data cache reads" },
+				{ PAPI_L3_DCW, "L3 data cache writes" },
+				{ PAPI_L3_ICA, "L3 instruction cache accesses" },
+				{ PAPI_L3_ICH, "L3 instruction cache hits" },
+				{ PAPI_L3_ICM, "L3 instruction cache misses" },
+				{ PAPI_L3_ICR, "L3 instruction cache reads" },
+				{ PAPI_L3_ICW, "L3 instruction cache writes" },
+				{ PAPI_L3_LDM, "L3 load misses" },
+				{ PAPI_L3_STM, "L3 store misses" },
+				{ PAPI_L3_TCA, "L3 total cache accesses" },
+				{ PAPI_L3_TCH, "L3 total cache hits" },
+				{ PAPI_L3_TCM, "L3 cache misses" },
+				{ PAPI_L3_TCR, "L3 total cache reads" },
+				{ PAPI_L3_TCW, "L3 total cache writes" },
+
+				// Data Access:
+				{ PAPI_LD_INS, "Load instructions" },
+				{ PAPI_LST_INS, "Load/store instructions completed" },
+				{ PAPI_LSU_IDL, "Cycles load/store units are idle" },
+				{ PAPI_MEM_RCY, "Cycles Stalled Waiting for memory Reads" },
+				{ PAPI_MEM_SCY, "Cycles Stalled Waiting for memory accesses" },
+				{ PAPI_MEM_WCY, "Cycles Stalled Waiting for memory writes" },
+				{ PAPI_PRF_DM, "Data prefetch cache misses" },
+				{ PAPI_RES_STL, "Cycles stalled on any resource" },
+				{ PAPI_SR_INS, "Store instructions" },
+				{ PAPI_STL_CCY, "Cycles with no instructions completed" },
+				{ PAPI_STL_ICY, "Cycles with no instruction issue" },
+				{ PAPI_SYC_INS, "Synchronization instructions completed" },
+
+				// TLB Operations:
+				{ PAPI_TLB_DM, "Data translation lookaside buffer misses" },
+				{ PAPI_TLB_IM, "Instruction translation lookaside buffer misses" },
+				{ PAPI_TLB_SD, "Translation lookaside buffer shootdowns" },
+				{ PAPI_TLB_TL, "Total translation lookaside buffer misses" },
+			};
+
+			constexpr static const char * search(const enum_t key, const size_t idx) {
+				return idx >= sizeof(mapping) / sizeof(decltype(*mapping)) ? "NOTFOUND" :
+					(key == mapping[idx].key ? mapping[idx].val : search(key, idx + 1));
+			}
+
+			constexpr static const char * lookup(enum_t key) {
+				return search(key, 0);
+			}
+		}
+
+		enum class branching: enum_t {
+			CNI = PAPI_BR_CN,   // Conditional branch instructions
+			INS = PAPI_BR_INS,  // Branch instructions
+			MSP = PAPI_BR_MSP,  // Conditional branch instructions mispredicted
+			NTK = PAPI_BR_NTK,  // Conditional branch instructions not taken
+			PRC = PAPI_BR_PRC,  // Conditional branch instructions correctly predicted
+			TKN = PAPI_BR_TKN,  // Conditional branch instructions taken
+			UCN = PAPI_BR_UCN,  // Unconditional branch instructions
+			IDL = PAPI_BRU_IDL, // Cycles branch units are idle
+			BTM = PAPI_BTAC_M,  // Branch target address cache misses
+		};
+
+		enum class stores: enum_t {
+			FAL = PAPI_CSR_FAL, // Failed store conditional instructions
+			SUC = PAPI_CSR_SUC, // Successful store conditional instructions
+			TOT = PAPI_CSR_TOT, // Total store conditional instructions
+		};
+
+		enum class instructions: enum_t {
+			FCC = PAPI_FUL_CCY, // Cycles with maximum instructions completed
+			FIC = PAPI_FUL_ICY, // Cycles with maximum instruction issue
+			IDL = PAPI_FXU_IDL, // Cycles integer units are idle
+			HWI = PAPI_HW_INT,  // Hardware interrupts
+			INT = PAPI_INT_INS, // Integer instructions
+			CYC = PAPI_TOT_CYC, // Total cycles
+			IIS = PAPI_TOT_IIS, // Instructions issued
+			INS = PAPI_TOT_INS, // Instructions completed
+			VEC = PAPI_VEC_INS, // Vector/SIMD instructions
+		};
+
+		namespace floating {
+			enum class instructions: enum_t {
+				FAD = PAPI_FAD_INS, // Floating point add instructions
+				FDV = PAPI_FDV_INS, // Floating point divide instructions
+				FMA = PAPI_FMA_INS, // FMA instructions completed
+				FML = PAPI_FML_INS, // Floating point multiply instructions
+				FNV = PAPI_FNV_INS, // Floating point inverse instructions
+				FP  = PAPI_FP_INS,  // Floating point instructions
+				FSQ = PAPI_FSQ_INS, // Floating point square root instructions
+				VSP = PAPI_VEC_SP, // Single precision vector/SIMD instructions
+				VDP = PAPI_VEC_DP, // Double precision vector/SIMD instructions
+			};
+
+			enum class operations: enum_t {
+				FP = PAPI_FP_OPS, // Floating point operations
+				SP = PAPI_SP_OPS, // Floating point operations executed; optimized to count scaled single precision vector operations
+				DP = PAPI_DP_OPS, // Floating point operations executed; optimized to count scaled double precision vector operations
+			};
+
+			enum class efficiency: enum_t {
+				STL = PAPI_FP_STAL, // Cycles the FP unit
+				IDL = PAPI_FPU_IDL, // Cycles floating point units are idle
+			};
+		}
+
+		namespace cache {
+			enum class requests: enum_t {
+				CLN = PAPI_CA_CLN, // Requests for exclusive access to clean cache line
+				INV = PAPI_CA_INV, // Requests for cache line invalidation
+				ITV = PAPI_CA_ITV, // Requests for cache line intervention
+				SHR = PAPI_CA_SHR, // Requests for exclusive access to shared cache line
+				SNP = PAPI_CA_SNP, // Requests for a snoop
+			};
+
+			enum class L1: enum_t {
+				DCA = PAPI_L1_DCA, // L1 data cache accesses
+				DCH = PAPI_L1_DCH, // L1 data cache hits
+				DCM = PAPI_L1_DCM, // L1 data cache misses
+				DCR = PAPI_L1_DCR, // L1 data cache reads
+				DCW = PAPI_L1_DCW, // L1 data cache writes
+				ICA = PAPI_L1_ICA, // L1 instruction cache accesses
+				ICH = PAPI_L1_ICH, // L1 instruction cache hits
+				ICM = PAPI_L1_ICM, // L1 instruction cache misses
+				ICR = PAPI_L1_ICR, // L1 instruction cache reads
+				ICW = PAPI_L1_ICW, // L1 instruction cache writes
+				LDM = PAPI_L1_LDM, // L1 load misses
+				STM = PAPI_L1_STM, // L1 store misses
+				TCA = PAPI_L1_TCA, // L1 total cache accesses
+				TCH = PAPI_L1_TCH, // L1 total cache hits
+				TCM = PAPI_L1_TCM, // L1 total cache misses
+				TCR = PAPI_L1_TCR, // L1 total cache reads
+				TCW = PAPI_L1_TCW, // L1 total cache writes
+			};
+
+			enum class L2: enum_t {
+				DCA = PAPI_L2_DCA, // L2 data cache accesses
+				DCH = PAPI_L2_DCH, // L2 data cache hits
+				DCM = PAPI_L2_DCM, // L2 data cache misses
+				DCR = PAPI_L2_DCR, // L2 data cache reads
+				DCW = PAPI_L2_DCW, // L2 data cache writes
+				ICA = PAPI_L2_ICA, // L2 instruction cache accesses
+				ICH = PAPI_L2_ICH, // L2 instruction cache hits
+				ICM = PAPI_L2_ICM, // L2 instruction cache misses
+				ICR = PAPI_L2_ICR, // L2 instruction cache reads
+				ICW = PAPI_L2_ICW, // L2 instruction cache writes
+				LDM = PAPI_L2_LDM, // L2 load misses
+				STM = PAPI_L2_STM, // L2 store misses
+				TCA = PAPI_L2_TCA, // L2 total cache accesses
+				TCH = PAPI_L2_TCH, // L2 total cache hits
+				TCM = PAPI_L2_TCM, // L2 total cache misses
+				TCR = PAPI_L2_TCR, // L2 total cache reads
+				TCW = PAPI_L2_TCW, // L2 total cache writes
+			};
+
+			enum class L3: enum_t {
+				DCA = PAPI_L3_DCA, // L3 data cache accesses
+				DCH = PAPI_L3_DCH, // L3 Data Cache Hits
+				DCM = PAPI_L3_DCM, // L3 data cache misses
+				DCR = PAPI_L3_DCR, // L3 data cache reads
+				DCW = PAPI_L3_DCW, // L3 data cache writes
+				ICA = PAPI_L3_ICA, // L3 instruction cache accesses
+				ICH = PAPI_L3_ICH, // L3 instruction cache hits
+				ICM = PAPI_L3_ICM, // L3 instruction cache misses
+				ICR = PAPI_L3_ICR, // L3 instruction cache reads
+				ICW = PAPI_L3_ICW, // L3 instruction cache writes
+				LDM = PAPI_L3_LDM, // L3 load misses
+				STM = PAPI_L3_STM, // L3 store misses
+				TCA = PAPI_L3_TCA, // L3 total cache accesses
+				TCH = PAPI_L3_TCH, // L3 total cache hits
+				TCM = PAPI_L3_TCM, // L3 cache misses
+				TCR = PAPI_L3_TCR, // L3 total cache reads
+				TCW = PAPI_L3_TCW, // L3 total cache writes
+			};
+		}
+
+		enum class TLB: enum_t {
+			DM = PAPI_TLB_DM, // Data translation lookaside buffer misses
+			IM = PAPI_TLB_IM, // Instruction translation lookaside buffer misses
+			SD = PAPI_TLB_SD, // Translation lookaside buffer shootdowns
+			TL = PAPI_TLB_TL, // Total translation lookaside buffer misses
+		};
+
+		enum class data_access: enum_t {
+			LDI = PAPI_LD_INS,  // Load instructions
+			LSI = PAPI_LST_INS, // Load/store instructions completed
+			IDL = PAPI_LSU_IDL, // Cycles load/store units are idle
+			RCY = PAPI_MEM_RCY, // Cycles Stalled Waiting for memory Reads
+			SCY = PAPI_MEM_SCY, // Cycles Stalled Waiting for memory accesses
+			WCY = PAPI_MEM_WCY, // Cycles Stalled Waiting for memory writes
+			DM  = PAPI_PRF_DM,  // Data prefetch cache misses
+			STL = PAPI_RES_STL, // Cycles stalled on any resource
+			STI = PAPI_SR_INS,  // Store instructions
+			CCY = PAPI_STL_CCY, // Cycles with no instructions completed
+			ICY = PAPI_STL_ICY, // Cycles with no instruction issue
+			SYI = PAPI_SYC_INS, // Synchronization instructions completed
+		};
+	}
+
+	// initialize PAPI, once
+	inline void papi_init() {
+		if (PAPI_NOT_INITED == PAPI_is_initialized()) {
+			const int rv = PAPI_library_init(PAPI_VER_CURRENT);
+			if (PAPI_VER_CURRENT != rv)
+				throw std::runtime_error("papi_init: PAPI library version mismatch");
+		}
+	}
+
+	// PAPI has to know how to tell threads apart before counting in more than
+	// one of them; call before starting any of them
+	inline void papi_threads_init() {
+		static bool done = false;
+		if (done)
+			return;
+		papi_init();
+		const int rv = PAPI_thread_init(reinterpret_cast<unsigned long (*)(void)>(pthread_self));
+		if (PAPI_OK != rv)
+			throw std::runtime_error(PAPI_strerror(rv));
+		done = true;
+	}
+
+	// Counts a list of events in the calling thread, using a PAPI event set.
+	// All events must fit in the hardware counters at once (see schedule() to
+	// split a list into lists that do). There is no multiplexing: PAPI does not
+	// tell how long each event was counted, so extrapolated counts could not be
+	// told apart from measured ones; the perf_event backend multiplexes.
+	class PerfStat {
+		public:
+			using value_t = long_long;
+
+			PerfStat(const Events & ev, bool multiplex = false)
+				: PerfStat(ev.to_vector(), multiplex) {}
+
+			// events as listed by Events::to_vector()
+			PerfStat(const std::vector<hwcounters::enum_t> & ev, bool multiplex = false)
+				: num_events(static_cast<PAPI_size_t>(ev.size())), events(ev), values(ev.size()),
+				coverage(ev.size(), 1), eventSet(PAPI_NULL)
+			{
+				if (multiplex)
+					throw std::runtime_error("PerfStat: PAPI does not report how long "
+							"multiplexed events were counted, multiplex through the perf_event "
+							"backend (a build without ADHD_PAPI)");
+				papi_init();
+				papi_error_check(PAPI_create_eventset(&eventSet));
+				for (size_t i = 0; i < events.size(); ++i) {
+					const int rv = PAPI_add_event(eventSet, events[i]);
+					if (PAPI_OK != rv) {
+						std::stringstream err;
+						err << "PerfStat: can not count \"" << hwcounters::names::lookup(events[i])
+							<< "\" along with the preceding " << i
+							<< " events (" << PAPI_strerror(rv) << "); schedule them";
+						destroy();
+						throw std::runtime_error(err.str());
+					}
+				}
+			}
+
+			PerfStat(const PerfStat &) = delete;
+			PerfStat & operator=(const PerfStat &) = delete;
+
+			PerfStat(PerfStat && other)
+				: num_events(other.num_events), events(std::move(other.events)),
+				values(std::move(other.values)), coverage(std::move(other.coverage)),
+				eventSet(other.eventSet)
+			{
+				other.eventSet = PAPI_NULL;
+			}
+
+			~PerfStat() { destroy(); }
+
+			inline void start() {
+				papi_error_check(PAPI_start(eventSet));
+			}
+
+			// the counts since start(), counting on; only in the counting thread
+			const inline std::vector<value_t> & read() {
+				papi_error_check(PAPI_read(eventSet, values.data()));
+				return values;
+			}
+
+			const inline PerfStat & stop() {
+				papi_error_check(PAPI_stop(eventSet, values.data()));
+				return *this;
+			}
+
+			const inline std::vector<value_t> & getValues() const {
+				return values;
+			}
+
+			// the part of the counting time every event was counted: all of it, as
+			// events are never multiplexed
+			const inline std::vector<double> & getCoverage() const {
+				return coverage;
+			}
+
+			inline bool isMultiplexed() const { return false; }
+
+			// number of hardware counters of the CPU
+			static inline PAPI_size_t counters() {
+				papi_init();
+				const PAPI_size_t num_ctrs = PAPI_num_cmp_hw_ctrs(0);
+				papi_error_check(num_ctrs, num_ctrs <= 0);
+				return num_ctrs;
+			}
+
+			// whether the CPU counts an event at all
+			static inline bool available(hwcounters::enum_t e) {
+				papi_init();
+				return PAPI_OK == PAPI_query_event(e);
+			}
+
+			// Split a list of events into lists that each fit in the hardware
+			// counters at once, keeping their order: counting every list in a run
+			// of its own counts all events exactly. Throws for events that can not
+			// be counted at all.
+			static std::vector<std::vector<hwcounters::enum_t>> schedule(
+					const std::vector<hwcounters::enum_t> & ev)
+			{
+				papi_init();
+				std::vector<std::vector<hwcounters::enum_t>> lists;
+				int probe = PAPI_NULL;
+				for (const auto e: ev) {
+					if (lists.empty() || PAPI_OK != PAPI_add_event(probe, e)) {
+						if (!lists.empty()) {
+							PAPI_cleanup_eventset(probe);
+							PAPI_destroy_eventset(&probe);
+						}
+						papi_error_check(PAPI_create_eventset(&probe));
+						const int rv = PAPI_add_event(probe, e);
+						if (PAPI_OK != rv) {
+							PAPI_destroy_eventset(&probe);
+							papi_error_check(rv);
+						}
+						lists.push_back(std::vector<hwcounters::enum_t>());
+					}
+					lists.back().push_back(e);
+				}
+				if (!lists.empty()) {
+					PAPI_cleanup_eventset(probe);
+					PAPI_destroy_eventset(&probe);
+				}
+				return lists;
+			}
+
+			friend inline
+				std::ostream & operator<<(std::ostream & os, const PerfStat & ps) {
+					for (PAPI_size_t i = 0; i < ps.num_events; ++i)
+						os << hwcounters::names::lookup(ps.events[i])
+							<< ": " << ps.values[i] << std::endl;
+					return os;
+				}
+
+		private:
+			PAPI_size_t num_events;
+			std::vector<hwcounters::enum_t> events;
+			std::vector<value_t> values;
+			std::vector<double> coverage;
+			int eventSet;
+
+			void destroy() {
+				if (PAPI_NULL != eventSet) {
+					PAPI_cleanup_eventset(eventSet);
+					PAPI_destroy_eventset(&eventSet);
+					eventSet = PAPI_NULL;
+				}
+			}
+
+			static inline void papi_error_check(int errval) {
+				papi_error_check(errval, errval != PAPI_OK);
+			}
+
+			static inline void papi_error_check (int errval, bool errcond) {
+				if (errcond) {
+					std::stringstream err;
+					err << "PerfStat - PAPI error: " << PAPI_strerror(errval);
+					throw std::runtime_error(err.str());
+				}
+			}
+	};
+}
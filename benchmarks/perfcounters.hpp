@@ -0,0 +1,604 @@
+#pragma once
+
+// perf_event backend of hwcounters.hpp: event codes are generic perf_event
+// events, see perf_event_open(2)
+
+#include "hwcounters.hpp"
+#include "rdtsc.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace adhd {
+	namespace hwcounters {
+		// event codes: the perf_event type above bit 24, its config below
+		namespace perf {
+			constexpr enum_t code(uint32_t type, uint32_t config) {
+				return static_cast<enum_t>(type << 24 | config);
+			}
+			constexpr uint32_t type(enum_t code) { return static_cast<uint32_t>(code) >> 24; }
+			constexpr uint32_t config(enum_t code) { return static_cast<uint32_t>(code) & 0xffffff; }
+
+			constexpr enum_t hardware(uint32_t id) { return code(PERF_TYPE_HARDWARE, id); }
+			constexpr enum_t software(uint32_t id) { return code(PERF_TYPE_SOFTWARE, id); }
+			constexpr enum_t cache(uint32_t id, uint32_t op, uint32_t result) {
+				return code(PERF_TYPE_HW_CACHE, id | op << 8 | result << 16);
+			}
+
+			// events without a generic perf_event equivalent: count those with PAPI
+			constexpr enum_t NONE = -1;
+
+			constexpr enum_t CYCLES = hardware(PERF_COUNT_HW_CPU_CYCLES);
+			constexpr enum_t INSTRUCTIONS = hardware(PERF_COUNT_HW_INSTRUCTIONS);
+			constexpr enum_t BRANCHES = hardware(PERF_COUNT_HW_BRANCH_INSTRUCTIONS);
+			constexpr enum_t BRANCH_MISSES = hardware(PERF_COUNT_HW_BRANCH_MISSES);
+			constexpr enum_t LLC_REFERENCES = hardware(PERF_COUNT_HW_CACHE_REFERENCES);
+			constexpr enum_t LLC_MISSES = hardware(PERF_COUNT_HW_CACHE_MISSES);
+
+			constexpr enum_t L1D_READS = cache(PERF_COUNT_HW_CACHE_L1D,
+					PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+			constexpr enum_t L1D_READ_MISSES = cache(PERF_COUNT_HW_CACHE_L1D,
+					PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			constexpr enum_t L1D_WRITES = cache(PERF_COUNT_HW_CACHE_L1D,
+					PERF_COUNT_HW_CACHE_OP_WRITE, PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+			constexpr enum_t L1D_WRITE_MISSES = cache(PERF_COUNT_HW_CACHE_L1D,
+					PERF_COUNT_HW_CACHE_OP_WRITE, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			constexpr enum_t L1I_READS = cache(PERF_COUNT_HW_CACHE_L1I,
+					PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+			constexpr enum_t L1I_READ_MISSES = cache(PERF_COUNT_HW_CACHE_L1I,
+					PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			constexpr enum_t LL_READS = cache(PERF_COUNT_HW_CACHE_LL,
+					PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+			constexpr enum_t LL_READ_MISSES = cache(PERF_COUNT_HW_CACHE_LL,
+					PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			constexpr enum_t LL_WRITES = cache(PERF_COUNT_HW_CACHE_LL,
+					PERF_COUNT_HW_CACHE_OP_WRITE, PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+			constexpr enum_t LL_WRITE_MISSES = cache(PERF_COUNT_HW_CACHE_LL,
+					PERF_COUNT_HW_CACHE_OP_WRITE, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			constexpr enum_t DTLB_READ_MISSES = cache(PERF_COUNT_HW_CACHE_DTLB,
+					PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			constexpr enum_t ITLB_READ_MISSES = cache(PERF_COUNT_HW_CACHE_ITLB,
+					PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+
+			// kernel events, available without a hardware PMU (e.g. in VMs)
+			constexpr enum_t TASK_CLOCK = software(PERF_COUNT_SW_TASK_CLOCK);
+			constexpr enum_t PAGE_FAULTS = software(PERF_COUNT_SW_PAGE_FAULTS);
+			constexpr enum_t MINOR_FAULTS = software(PERF_COUNT_SW_PAGE_FAULTS_MIN);
+			constexpr enum_t MAJOR_FAULTS = software(PERF_COUNT_SW_PAGE_FAULTS_MAJ);
+			constexpr enum_t CONTEXT_SWITCHES = software(PERF_COUNT_SW_CONTEXT_SWITCHES);
+			constexpr enum_t CPU_MIGRATIONS = software(PERF_COUNT_SW_CPU_MIGRATIONS);
+		}
+
+		namespace names {
+			constexpr const struct entry {
+				const enum_t key;
+				const char * const val;
+			}  mapping[] {
+				{ perf::CYCLES, "Total cycles" },
+				{ perf::INSTRUCTIONS, "Instructions completed" },
+				{ perf::BRANCHES, "Branch instructions" },
+				{ perf::BRANCH_MISSES, "Branch instructions mispredicted" },
+				{ perf::LLC_REFERENCES, "Last level cache references" },
+				{ perf::LLC_MISSES, "Last level cache misses" },
+				{ perf::L1D_READS, "L1 data cache reads" },
+				{ perf::L1D_READ_MISSES, "L1 data cache read misses" },
+				{ perf::L1D_WRITES, "L1 data cache writes" },
+				{ perf::L1D_WRITE_MISSES, "L1 data cache write misses" },
+				{ perf::L1I_READS, "L1 instruction cache reads" },
+				{ perf::L1I_READ_MISSES, "L1 instruction cache misses" },
+				{ perf::LL_READS, "Last level cache reads" },
+				{ perf::LL_READ_MISSES, "Last level cache read misses" },
+				{ perf::LL_WRITES, "Last level cache writes" },
+				{ perf::LL_WRITE_MISSES, "Last level cache write misses" },
+				{ perf::DTLB_READ_MISSES, "Data translation lookaside buffer read misses" },
+				{ perf::ITLB_READ_MISSES, "Instruction translation lookaside buffer misses" },
+				{ perf::TASK_CLOCK, "Task clock (ns)" },
+				{ perf::PAGE_FAULTS, "Page faults" },
+				{ perf::MINOR_FAULTS, "Minor page faults" },
+				{ perf::MAJOR_FAULTS, "Major page faults" },
+				{ perf::CONTEXT_SWITCHES, "Context switches" },
+				{ perf::CPU_MIGRATIONS, "CPU migrations" },
+			};
+
+			constexpr static const char * search(const enum_t key, const size_t idx) {
+				return idx >= sizeof(mapping) / sizeof(decltype(*mapping)) ? "NOTFOUND" :
+					(key == mapping[idx].key ? mapping[idx].val : search(key, idx + 1));
+			}
+
+			constexpr static const char * lookup(enum_t key) {
+				return search(key, 0);
+			}
+		}
+
+		// the PAPI presets, as far as generic perf_event events count them
+		enum class branching: enum_t {
+			CNI = perf::NONE,              // Conditional branch instructions
+			INS = perf::BRANCHES,          // Branch instructions
+			MSP = perf::BRANCH_MISSES,     // Conditional branch instructions mispredicted
+			NTK = perf::NONE,              // Conditional branch instructions not taken
+			PRC = perf::NONE,              // Conditional branch instructions correctly predicted
+			TKN = perf::NONE,              // Conditional branch instructions taken
+			UCN = perf::NONE,              // Unconditional branch instructions
+			IDL = perf::NONE,              // Cycles branch units are idle
+			BTM = perf::NONE,              // Branch target address cache misses
+		};
+
+		enum class stores: enum_t {
+			FAL = perf::NONE,              // Failed store conditional instructions
+			SUC = perf::NONE,              // Successful store conditional instructions
+			TOT = perf::NONE,              // Total store conditional instructions
+		};
+
+		enum class instructions: enum_t {
+			FCC = perf::NONE,              // Cycles with maximum instructions completed
+			FIC = perf::NONE,              // Cycles with maximum instruction issue
+			IDL = perf::NONE,              // Cycles integer units are idle
+			HWI = perf::NONE,              // Hardware interrupts
+			INT = perf::NONE,              // Integer instructions
+			CYC = perf::CYCLES,            // Total cycles
+			IIS = perf::NONE,              // Instructions issued
+			INS = perf::INSTRUCTIONS,      // Instructions completed
+			VEC = perf::NONE,              // Vector/SIMD instructions
+		};
+
+		namespace floating {
+			enum class instructions: enum_t {
+				FAD = perf::NONE,              // Floating point add instructions
+				FDV = perf::NONE,              // Floating point divide instructions
+				FMA = perf::NONE,              // FMA instructions completed
+				FML = perf::NONE,              // Floating point multiply instructions
+				FNV = perf::NONE,              // Floating point inverse instructions
+				FP  = perf::NONE,              // Floating point instructions
+				FSQ = perf::NONE,              // Floating point square root instructions
+				VSP = perf::NONE,              // Single precision vector/SIMD instructions
+				VDP = perf::NONE,              // Double precision vector/SIMD instructions
+			};
+
+			enum class operations: enum_t {
+				FP  = perf::NONE,              // Floating point operations
+				SP  = perf::NONE,              // Floating point operations executed; optimized to count scaled single precision vector operations
+				DP  = perf::NONE,              // Floating point operations executed; optimized to count scaled double precision vector operations
+			};
+
+			enum class efficiency: enum_t {
+				STL = perf::NONE,              // Cycles the FP unit
+				IDL = perf::NONE,              // Cycles floating point units are idle
+			};
+		}
+
+		namespace cache {
+			enum class requests: enum_t {
+				CLN = perf::NONE,              // Requests for exclusive access to clean cache line
+				INV = perf::NONE,              // Requests for cache line invalidation
+				ITV = perf::NONE,              // Requests for cache line intervention
+				SHR = perf::NONE,              // Requests for exclusive access to shared cache line
+				SNP = perf::NONE,              // Requests for a snoop
+			};
+
+			enum class L1: enum_t {
+				DCA = perf::NONE,              // L1 data cache accesses
+				DCH = perf::NONE,              // L1 data cache hits
+				DCM = perf::L1D_READ_MISSES,   // L1 data cache misses
+				DCR = perf::L1D_READS,         // L1 data cache reads
+				DCW = perf::L1D_WRITES,        // L1 data cache writes
+				ICA = perf::L1I_READS,         // L1 instruction cache accesses
+				ICH = perf::NONE,              // L1 instruction cache hits
+				ICM = perf::L1I_READ_MISSES,   // L1 instruction cache misses
+				ICR = perf::L1I_READS,         // L1 instruction cache reads
+				ICW = perf::NONE,              // L1 instruction cache writes
+				LDM = perf::L1D_READ_MISSES,   // L1 load misses
+				STM = perf::L1D_WRITE_MISSES,  // L1 store misses
+				TCA = perf::NONE,              // L1 total cache accesses
+				TCH = perf::NONE,              // L1 total cache hits
+				TCM = perf::NONE,              // L1 total cache misses
+				TCR = perf::NONE,              // L1 total cache reads
+				TCW = perf::NONE,              // L1 total cache writes
+			};
+
+			enum class L2: enum_t {
+				DCA = perf::NONE,              // L2 data cache accesses
+				DCH = perf::NONE,              // L2 data cache hits
+				DCM = perf::NONE,              // L2 data cache misses
+				DCR = perf::NONE,              // L2 data cache reads
+				DCW = perf::NONE,              // L2 data cache writes
+				ICA = perf::NONE,              // L2 instruction cache accesses
+				ICH = perf::NONE,              // L2 instruction cache hits
+				ICM = perf::NONE,              // L2 instruction cache misses
+				ICR = perf::NONE,              // L2 instruction cache reads
+				ICW = perf::NONE,              // L2 instruction cache writes
+				LDM = perf::NONE,              // L2 load misses
+				STM = perf::NONE,              // L2 store misses
+				TCA = perf::NONE,              // L2 total cache accesses
+				TCH = perf::NONE,              // L2 total cache hits
+				TCM = perf::NONE,              // L2 total cache misses
+				TCR = perf::NONE,              // L2 total cache reads
+				TCW = perf::NONE,              // L2 total cache writes
+			};
+
+			enum class L3: enum_t {
+				DCA = perf::NONE,              // L3 data cache accesses
+				DCH = perf::NONE,              // L3 Data Cache Hits
+				DCM = perf::NONE,              // L3 data cache misses
+				DCR = perf::NONE,              // L3 data cache reads
+				DCW = perf::NONE,              // L3 data cache writes
+				ICA = perf::NONE,              // L3 instruction cache accesses
+				ICH = perf::NONE,              // L3 instruction cache hits
+				ICM = perf::NONE,              // L3 instruction cache misses
+				ICR = perf::NONE,              // L3 instruction cache reads
+				ICW = perf::NONE,              // L3 instruction cache writes
+				LDM = perf::LL_READ_MISSES,    // L3 load misses
+				STM = perf::LL_WRITE_MISSES,   // L3 store misses
+				TCA = perf::LLC_REFERENCES,    // L3 total cache accesses
+				TCH = perf::NONE,              // L3 total cache hits
+				TCM = perf::LLC_MISSES,        // L3 cache misses
+				TCR = perf::LL_READS,          // L3 total cache reads
+				TCW = perf::LL_WRITES,         // L3 total cache writes
+			};
+		}
+
+		enum class TLB: enum_t {
+			DM  = perf::DTLB_READ_MISSES,  // Data translation lookaside buffer misses
+			IM  = perf::ITLB_READ_MISSES,  // Instruction translation lookaside buffer misses
+			SD  = perf::NONE,              // Translation lookaside buffer shootdowns
+			TL  = perf::NONE,              // Total translation lookaside buffer misses
+		};
+
+		enum class data_access: enum_t {
+			LDI = perf::NONE,              // Load instructions
+			LSI = perf::NONE,              // Load/store instructions completed
+			IDL = perf::NONE,              // Cycles load/store units are idle
+			RCY = perf::NONE,              // Cycles Stalled Waiting for memory Reads
+			SCY = perf::NONE,              // Cycles Stalled Waiting for memory accesses
+			WCY = perf::NONE,              // Cycles Stalled Waiting for memory writes
+			DM  = perf::NONE,              // Data prefetch cache misses
+			STL = perf::NONE,              // Cycles stalled on any resource
+			STI = perf::NONE,              // Store instructions
+			CCY = perf::NONE,              // Cycles with no instructions completed
+			ICY = perf::NONE,              // Cycles with no instruction issue
+			SYI = perf::NONE,              // Synchronization instructions completed
+		};
+	}
+
+	// Counts a list of events in the calling thread through perf_event_open(2),
+	// in user space only. Without multiplexing, the events form a group that the
+	// kernel puts on the counters all at once and that is read in one go
+	// (PERF_FORMAT_GROUP), so they must fit in the counters together (see
+	// schedule() to split a list into lists that do); multiplexed, every event
+	// is a group of its own and the kernel rotates them through the counters.
+	// The events count from construction on: start(), read() and stop() take
+	// readings, the counts are their difference to the one of start(), scaled
+	// by the time the events were enabled over the time they actually ran.
+	// Where the kernel allows it (see /sys/devices/cpu/rdpmc), the counting
+	// thread reads hardware events in user space with rdpmc, tens of cycles
+	// instead of a read() system call; other threads may read() as well,
+	// through the kernel.
+	class PerfStat {
+		public:
+			using value_t = long long;
+
+			PerfStat(const Events & ev, bool multiplex = false)
+				: PerfStat(ev.to_vector(), multiplex) {}
+
+			// events as listed by Events::to_vector()
+			PerfStat(const std::vector<hwcounters::enum_t> & ev, bool multiplex = false)
+				: events(ev), values(ev.size()), coverage(ev.size(), 1), fds(), pages(),
+				begin(ev.size()), end(ev.size()), now(ev.size()), groupData(),
+				owner(pthread_self()), multiplexed(multiplex), userReads(!ev.empty())
+			{
+				const long pageSize = sysconf(_SC_PAGESIZE);
+				for (size_t i = 0; i < events.size(); ++i) {
+					const int group = multiplexed || fds.empty() ? -1 : fds[0];
+					const int fd = open(events[i], group, !multiplexed);
+					if (fd < 0) {
+						const std::string err = failure(events[i], i, group < 0 ? 0 : i, errno);
+						destroy();
+						throw std::runtime_error(err);
+					}
+					fds.push_back(fd);
+
+					// only hardware events ever sit on a counter rdpmc can read
+					const uint32_t type = hwcounters::perf::type(events[i]);
+					void * page = PERF_TYPE_SOFTWARE == type ? MAP_FAILED :
+						mmap(NULL, static_cast<size_t>(pageSize), PROT_READ, MAP_SHARED, fd, 0);
+					pages.push_back(MAP_FAILED == page ? NULL : static_cast<perf_event_mmap_page *>(page));
+					userReads = userReads && MAP_FAILED != page;
+				}
+				// { nr, time_enabled, time_running, value[nr] }
+				if (!multiplexed)
+					groupData.resize(3 + events.size());
+			}
+
+			PerfStat(const PerfStat &) = delete;
+			PerfStat & operator=(const PerfStat &) = delete;
+
+			PerfStat(PerfStat && other)
+				: events(std::move(other.events)), values(std::move(other.values)),
+				coverage(std::move(other.coverage)), fds(std::move(other.fds)),
+				pages(std::move(other.pages)), begin(std::move(other.begin)),
+				end(std::move(other.end)), now(std::move(other.now)),
+				groupData(std::move(other.groupData)), owner(other.owner),
+				multiplexed(other.multiplexed), userReads(other.userReads)
+			{
+				other.fds.clear();
+				other.pages.clear();
+			}
+
+			~PerfStat() { destroy(); }
+
+			inline void start() {
+				take(begin);
+			}
+
+			// the counts since start(), counting on; not to be called concurrently
+			// with start() or stop()
+			const inline std::vector<value_t> & read() {
+				take(now);
+				since(now);
+				return values;
+			}
+
+			const inline PerfStat & stop() {
+				take(end);
+				since(end);
+				return *this;
+			}
+
+			const inline std::vector<value_t> & getValues() const {
+				return values;
+			}
+
+			// the part of the counting time every event was counted
+			const inline std::vector<double> & getCoverage() const {
+				return coverage;
+			}
+
+			inline bool isMultiplexed() const { return multiplexed; }
+
+			// number of general purpose hardware counters: the most events that
+			// fit in a group, as the kernel validates groups when they are made
+			// (e.g. on x86); 0 without a hardware PMU
+			static inline PAPI_size_t counters() {
+				static const PAPI_size_t probed = [] {
+					std::vector<int> group;
+					while (group.size() < MAX_PROBED) {
+						const int fd = open(hwcounters::perf::BRANCH_MISSES,
+								group.empty() ? -1 : group[0], true);
+						if (fd < 0)
+							break;
+						group.push_back(fd);
+					}
+					const auto found = static_cast<PAPI_size_t>(group.size());
+					close(group);
+					return found;
+				}();
+				return probed;
+			}
+
+			// whether the kernel counts an event at all, on its own
+			static inline bool available(hwcounters::enum_t e) {
+				const int fd = open(e, -1, true);
+				if (fd < 0)
+					return false;
+				::close(fd);
+				return true;
+			}
+
+			// Split a list of events into lists that each fit in the hardware
+			// counters at once, keeping their order: counting every list in a run
+			// of its own counts all events exactly. Throws for events that can not
+			// be counted at all.
+			static std::vector<std::vector<hwcounters::enum_t>> schedule(
+					const std::vector<hwcounters::enum_t> & ev)
+			{
+				std::vector<std::vector<hwcounters::enum_t>> lists;
+				std::vector<int> probe;
+				for (size_t i = 0; i < ev.size(); ++i) {
+					int fd = probe.empty() ? -1 : open(ev[i], probe[0], true);
+					if (fd < 0) {
+						close(probe);
+						fd = open(ev[i], -1, true);
+						if (fd < 0)
+							throw std::runtime_error(failure(ev[i], i, 0, errno));
+						lists.push_back(std::vector<hwcounters::enum_t>());
+					}
+					probe.push_back(fd);
+					lists.back().push_back(ev[i]);
+				}
+				close(probe);
+				return lists;
+			}
+
+			friend inline
+				std::ostream & operator<<(std::ostream & os, const PerfStat & ps) {
+					for (size_t i = 0; i < ps.events.size(); ++i)
+						os << hwcounters::names::lookup(ps.events[i])
+							<< ": " << ps.values[i] << std::endl;
+					return os;
+				}
+
+		private:
+			// a counter and the times (ns) its event was enabled and running
+			struct Reading {
+				uint64_t count;
+				uint64_t enabled;
+				uint64_t running;
+			};
+
+			static constexpr size_t MAX_PROBED = 64;
+			// perf_event_mmap_page::capabilities
+			static constexpr uint64_t CAP_USER_RDPMC = 1 << 2;
+			static constexpr uint64_t CAP_USER_TIME = 1 << 3;
+			static constexpr uint64_t CAP_USER_TIME_SHORT = 1 << 5;
+
+			std::vector<hwcounters::enum_t> events;
+			std::vector<value_t> values;
+			std::vector<double> coverage;
+			std::vector<int> fds;
+			std::vector<perf_event_mmap_page *> pages;
+			std::vector<Reading> begin;
+			std::vector<Reading> end;
+			std::vector<Reading> now;
+			std::vector<uint64_t> groupData;
+			// the counting thread, the only one that may use rdpmc
+			pthread_t owner;
+			bool multiplexed;
+			bool userReads;
+
+			void destroy() {
+				const long pageSize = sysconf(_SC_PAGESIZE);
+				for (const auto page: pages)
+					if (page)
+						munmap(page, static_cast<size_t>(pageSize));
+				pages.clear();
+				close(fds);
+			}
+
+			inline void take(std::vector<Reading> & r) {
+				if (!userReads || !pthread_equal(owner, pthread_self()) || !readUser(r))
+					readKernel(r);
+			}
+
+			// values and coverage from the readings of start() to r
+			void since(const std::vector<Reading> & r) {
+				for (size_t i = 0; i < events.size(); ++i) {
+					const uint64_t enabled = r[i].enabled - begin[i].enabled;
+					const uint64_t running = r[i].running - begin[i].running;
+					const double counted = static_cast<double>(r[i].count - begin[i].count);
+					if (running == enabled) {
+						coverage[i] = 1;
+						values[i] = static_cast<value_t>(counted);
+					}
+					else {
+						coverage[i] = static_cast<double>(running) / static_cast<double>(enabled);
+						values[i] = running ? static_cast<value_t>(counted / coverage[i] + 0.5) : 0;
+					}
+				}
+			}
+
+			void readKernel(std::vector<Reading> & r) {
+				if (!multiplexed) {
+					readFd(fds[0], groupData.data(), groupData.size());
+					for (size_t i = 0; i < r.size(); ++i)
+						r[i] = Reading { groupData[3 + i], groupData[1], groupData[2] };
+				}
+				else
+					for (size_t i = 0; i < r.size(); ++i) {
+						uint64_t data[3];
+						readFd(fds[i], data, 3);
+						r[i] = Reading { data[0], data[1], data[2] };
+					}
+			}
+
+			// rdpmc, following the recipe in linux/perf_event.h; false when the
+			// kernel does not allow it, or an event is not on a counter right now
+			bool readUser(std::vector<Reading> & r) const {
+#if defined(__x86_64__) || defined(__i386__)
+				for (size_t i = 0; i < pages.size(); ++i) {
+					const volatile perf_event_mmap_page * pc = pages[i];
+					uint32_t seq;
+					do {
+						seq = pc->lock;
+						asm volatile ("" ::: "memory");
+						const uint64_t caps = pc->capabilities;
+						const uint32_t index = pc->index;
+						if (!(caps & CAP_USER_RDPMC) || !(caps & CAP_USER_TIME) ||
+								(caps & CAP_USER_TIME_SHORT) || 0 == index)
+							return false;
+						// the times of the last update by the kernel, brought up to date
+						const uint64_t cyc = rdtsc();
+						const uint16_t shift = pc->time_shift;
+						const uint64_t mult = pc->time_mult;
+						const uint64_t delta = pc->time_offset + (cyc >> shift) * mult +
+							(((cyc & ((uint64_t(1) << shift) - 1)) * mult) >> shift);
+						const unsigned width = 64 - pc->pmc_width;
+						const int64_t pmc = static_cast<int64_t>(rdpmc(index - 1) << width) >> width;
+						r[i] = Reading { static_cast<uint64_t>(pc->offset + pmc),
+							pc->time_enabled + delta, pc->time_running + delta };
+						asm volatile ("" ::: "memory");
+					} while (pc->lock != seq);
+				}
+				return true;
+#else
+				(void) r;
+				return false;
+#endif
+			}
+
+#if defined(__x86_64__) || defined(__i386__)
+			static inline uint64_t rdpmc(uint32_t counter) {
+				uint32_t lo, hi;
+				asm volatile ("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+				return lo | ((uint64_t) hi << 32);
+			}
+#endif
+
+			static inline void readFd(int fd, uint64_t * data, size_t n) {
+				const ssize_t size = static_cast<ssize_t>(n * sizeof(uint64_t));
+				if (size != ::read(fd, data, static_cast<size_t>(size)))
+					throw std::runtime_error(std::string("PerfStat: reading counters failed: ") +
+							std::strerror(errno));
+			}
+
+			// a group (leader first) resp. a single event of the calling thread
+			static int open(hwcounters::enum_t e, int group, bool grouped) {
+				if (hwcounters::perf::NONE == e) {
+					errno = ENOENT;
+					return -1;
+				}
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = hwcounters::perf::type(e);
+				attr.config = hwcounters::perf::config(e);
+				// user space only, as PAPI counts by default and as unprivileged
+				// users may with perf_event_paranoid 2
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				if (grouped)
+					attr.read_format |= PERF_FORMAT_GROUP;
+				return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group,
+							PERF_FLAG_FD_CLOEXEC));
+			}
+
+			static void close(std::vector<int> & fds) {
+				for (const auto fd: fds)
+					::close(fd);
+				fds.clear();
+			}
+
+			// event at position in a list, opened after preceding others of its group
+			static std::string failure(hwcounters::enum_t e, size_t position,
+					size_t preceding, int err)
+			{
+				std::stringstream msg;
+				msg << "PerfStat: can not count ";
+				if (hwcounters::perf::NONE == e) {
+					msg << "event " << position + 1 << " of the list: it has no generic "
+						"perf_event equivalent, count it through PAPI (make PAPI=1)";
+					return msg.str();
+				}
+				msg << "\"" << hwcounters::names::lookup(e) << "\"";
+				if (preceding)
+					msg << " along with the preceding " << preceding << " events";
+				msg << " (" << std::strerror(err) << ")";
+				if (EACCES == err || EPERM == err)
+					msg << "; see /proc/sys/kernel/perf_event_paranoid";
+				else if (preceding)
+					msg << "; schedule or multiplex them";
+				return msg.str();
+			}
+	};
+}
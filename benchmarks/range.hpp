@@ -1,12 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <initializer_list>
 #include <iostream>
 #include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace adhd {
@@ -175,10 +180,10 @@ namespace adhd {
 							<< r.current << (r.reset ? " (reset)" : "");
 					}
 
-				const T minValue;
-				const T maxValue;
-				const T mulValue;
-				const T incValue;
+				T minValue;
+				T maxValue;
+				T mulValue;
+				T incValue;
 
 			private:
 				AffineStepper(T min, T max, T mul, T inc, bool _reset)
@@ -218,13 +223,13 @@ namespace adhd {
 					return new ExplicitStepper(*this);
 				}
 
-				bool operator==(const ExplicitStepper & rhs) {
+				bool operator==(const ExplicitStepper & rhs) const {
 					return values == rhs.values
 						&& current == rhs.current
 						&& reset == rhs.reset;
 				}
 
-				bool operator!=(const ExplicitStepper & rhs) {
+				bool operator!=(const ExplicitStepper & rhs) const {
 					return !operator==(rhs);
 				}
 
@@ -258,12 +263,188 @@ namespace adhd {
 
 			private:
 				bool reset;
-				const values_ptr values;
+				values_ptr values;
 				values_iterator current;
 
 			public:
-				const T minValue;
-				const T maxValue;
+				T minValue;
+				T maxValue;
+		};
+
+	// Range refining a coarse grid where a measurement changes most. The coarse
+	// grid consists of the values an AffineStepper(min, max, mul, inc) takes.
+	// Clients feed back a measurement for every value using record(); once the
+	// grid is exhausted, the interval between the two adjacent values whose
+	// measurements differ most is bisected, as long as they differ by more than
+	// 'threshold' (relative), the interval is wider than 'resolution' (relative
+	// to its lower bound), and less than 'budget' seconds (when non-zero) passed
+	// since the sweep started. A zero threshold disables refinement, and the
+	// stepper behaves like an AffineStepper. Bisection points are rounded down
+	// to a multiple of 'granule'.
+	// Copies share their measurements, so that feedback recorded through any copy
+	// (e.g. the benchmark clone an iterator runs) steers all of them. Every sweep,
+	// from gotoBegin() until the range resets, starts from a clean slate.
+	template <typename T>
+		class AdaptiveStepper: public virtual RangeInterface {
+			private:
+				struct State {
+					std::mutex mutex;
+					// value -> (sum of measurements, number of measurements)
+					std::map<T, std::pair<double, unsigned>> samples;
+					std::chrono::steady_clock::time_point start;
+				};
+				using state_ptr = std::shared_ptr<State>;
+
+			public:
+				AdaptiveStepper(T min, T max, T mul = 1, T inc = 1, double _threshold = 0,
+						double _resolution = 0.05, double _budget = 0, T _granule = 1)
+					: minValue(min < max ? min : max), maxValue(min < max ? max : min),
+					mulValue(mul), incValue(inc), threshold(_threshold),
+					resolution(_resolution), budget(_budget), granule(_granule),
+					state(new State()), current(minValue), grid(true), reset(false)
+			{
+				restart();
+			}
+
+				// may be called concurrently, e.g. by all threads of a benchmark
+				void record(T value, double measurement) const {
+					std::lock_guard<std::mutex> lock(state->mutex);
+					auto & sample = state->samples[value];
+					sample.first += measurement;
+					++sample.second;
+				}
+
+				virtual void next() override {
+					reset = false;
+					if (grid) {
+						const T value = mulValue * current + incValue;
+						if (current < maxValue && value <= maxValue && value > current) {
+							current = value;
+							return;
+						}
+						grid = false;
+					}
+					if (!refine()) {
+						// sweep done
+						current = minValue;
+						grid = true;
+						reset = true;
+						restart();
+					}
+				}
+
+				virtual AdaptiveStepper * clone() const override {
+					return new AdaptiveStepper(*this);
+				}
+
+				bool operator==(const AdaptiveStepper & rhs) const {
+					return minValue == rhs.minValue
+						&& maxValue == rhs.maxValue
+						&& state == rhs.state
+						&& current == rhs.current
+						&& reset == rhs.reset;
+				}
+
+				bool operator!=(const AdaptiveStepper & rhs) const {
+					return !operator==(rhs);
+				}
+
+				T getValue() const {
+					return current;
+				}
+
+				virtual bool atMin() const override {
+					return minValue == current;
+				}
+
+				virtual bool atMax() const override {
+					return maxValue == current;
+				}
+
+				virtual void gotoBegin() override {
+					current = minValue;
+					grid = true;
+					reset = false;
+					restart();
+				}
+
+				virtual void gotoEnd() override {
+					current = minValue;
+					grid = true;
+					reset = true;
+				}
+
+				friend inline
+					std::ostream & operator<<(std::ostream & os, const AdaptiveStepper & r) {
+						return os << "[" << r.minValue << "," << r.maxValue << "]~:"
+							<< r.current << (r.reset ? " (reset)" : "");
+					}
+
+				T minValue;
+				T maxValue;
+				T mulValue;
+				T incValue;
+				double threshold;
+				double resolution;
+				double budget;
+				T granule;
+
+			private:
+				state_ptr state;
+				T current;
+				// still stepping through the coarse grid
+				bool grid;
+				bool reset;
+
+				void restart() {
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->samples.clear();
+					state->start = std::chrono::steady_clock::now();
+				}
+
+				// move to the midpoint of the interval with the largest relative
+				// difference in measurements, if any qualifies
+				bool refine() {
+					using namespace std::chrono;
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (threshold <= 0)
+						return false;
+					const double elapsed = duration<double>(steady_clock::now() - state->start).count();
+					if (budget > 0 && elapsed > budget)
+						return false;
+
+					double largest = threshold;
+					bool found = false;
+					T best = current;
+					auto lo = state->samples.cend();
+					for (auto hi = state->samples.cbegin(); hi != state->samples.cend(); ++hi) {
+						// skip values that were visited, but not measured
+						if (0 == hi->second.second)
+							continue;
+						if (lo != state->samples.cend()) {
+							const double mlo = lo->second.first / lo->second.second;
+							const double mhi = hi->second.first / hi->second.second;
+							const double diff = std::fabs(mhi - mlo) / std::min(mlo, mhi);
+							T mid = static_cast<T>(lo->first + (hi->first - lo->first) / 2);
+							mid = static_cast<T>(mid / granule * granule);
+							if (diff > largest
+									&& static_cast<double>(hi->first - lo->first)
+									> resolution * static_cast<double>(lo->first)
+									&& mid > lo->first && mid < hi->first
+									&& 0 == state->samples.count(mid)) {
+								largest = diff;
+								best = mid;
+								found = true;
+							}
+						}
+						lo = hi;
+					}
+					if (found) {
+						state->samples[best];
+						current = best;
+					}
+					return found;
+				}
 		};
 
 	// Heterogeneous collection of Range types. Incrementing the set will
@@ -293,6 +474,12 @@ namespace adhd {
 						return std::get<N>(values);
 					}
 
+				// ranges are assignable, e.g. to set up a RangeSet range by range
+				template <long unsigned int N>
+					field_t<N> & get() {
+						return std::get<N>(values);
+					}
+
 				template <long unsigned int N>
 					auto getValue() const -> decltype(this->get<N>().getValue()) {
 						return get<N>().getValue();
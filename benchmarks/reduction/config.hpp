@@ -27,7 +27,7 @@ namespace reduction {
 		static constexpr uint_fast32_t MiB = 1 << 11;
 	}
 
-	struct Config: public adhd::Config/*: public libconfig::Config */ {
+	struct Config/*: public libconfig::Config */ {
 		Config(
 				size_t _size_min      = defaults::size_min,
 				size_t _size_max      = defaults::size_max,
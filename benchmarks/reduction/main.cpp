@@ -6,6 +6,7 @@
 
 #include "reduction.hpp"
 #include "../benchmark.hpp"
+#include "../timers.hpp"
 #include "timings.hpp"
 
 using namespace std;
@@ -15,21 +16,20 @@ using namespace reduction;
 template <typename INDEX_T>
 static void run_test() {
 	try {
-		adhd::BenchmarkFactory && bmf = ReductionFactory();
-		auto test = bmf.makeBenchmark(Config());
-		test->run([] (const adhd::Timings & timings) {
+		Reduction<INDEX_T>(Config()).run([] (const adhd::Timings & timings) {
 				cout
 				<< "--- CSV ------------------------------------------" << endl
 				<< timings.asCSV() << endl
 				<< "--- HUMAN ----------------------------------------" << endl
 				<< timings.asHuman() << endl;
 				});
-		delete test;
 	}
 	catch (const length_error &) { /* deliberately ignored */ }
 }
 
 int main() {
+	// calibrates the TSC before any measurement
+	adhd::timers::describe(cerr) << endl;
 	//run_test<uint8_t>();
 	//run_test<uint16_t>();
 	//run_test<uint32_t>();
@@ -8,7 +8,8 @@
 
 #include "reduction.hpp"
 #include "../benchmark.hpp"
-#include "../rdtsc.h"
+#include "../kernels.hpp"
+#include "../timers.hpp"
 #include "timings.hpp"
 #include "util.hpp"
 
@@ -37,24 +38,17 @@ namespace reduction {
 	static const char NOT_INITIALIZED[] =
 		"Default-constructed walking array was not initialized.";
 
-	adhd::Benchmark * ReductionFactory::makeBenchmark(const adhd::Config & cfg) const {
-		// TODO: use actual config passed here, instead of using default config
-		return new Reduction<uint64_t>(Config());
-	}
-
 	template <typename INDEX_T>
 	Reduction<INDEX_T>::Reduction(const Config & _config):
 		config(_config),
 		length(0),
-		arraymem(NULL),
+		arraymem(),
 		array(NULL)
 	{}
 
 	template <typename INDEX_T>
 	Reduction<INDEX_T>::~Reduction()
-	{
-		delete[] arraymem;
-	}
+	{}
 
 	template <typename INDEX_T>
 	void Reduction<INDEX_T>::run(adhd::timing_cb tcb)
@@ -92,14 +86,14 @@ namespace reduction {
 			if (!util::isPowerOfTwo<size_t>(config.align))
 				throw domain_error(NOT_POW2_ALIGN);
 
-			// allocate with overhead to cater for later alignment
-			// arraymem must be NULL or previously allocated by this function
-			const size_t overhead = 1 + config.align / sizeof(INDEX_T);
-			delete[] arraymem;
-			arraymem = new INDEX_T[length + overhead];
-			const uintptr_t aligned =
-				(reinterpret_cast<uintptr_t>(arraymem) + config.align) & (~(config.align - 1));
-			array = reinterpret_cast<INDEX_T *>(aligned);
+			// the array at the start of the arena, aligned without allocating any
+			// overhead; only the pages a larger size adds are faulted, here
+			// rather than while reducing
+			arraymem.reserve(config.size_max, config.align, adhd::PageBacking::SMALL);
+			arraymem.reset();
+			array = static_cast<INDEX_T *>(arraymem.window(length * sizeof(INDEX_T),
+						config.align, adhd::PageBacking::SMALL));
+			arraymem.populate(array, length * sizeof(INDEX_T));
 
 			// init with ones
 			INDEX_T idx;
@@ -119,6 +113,11 @@ namespace reduction {
 		}
 	}
 
+	template <typename INDEX_T>
+		Reduction<INDEX_T> * Reduction<INDEX_T>::clone() const {
+			return new Reduction<INDEX_T>(config);
+		}
+
 #include "reduction_loc.ii"
 #include "reduction_vec.ii"
 
@@ -1,6 +1,7 @@
 #include "timings.hpp"
 
 #include "../prettyprint.hpp"
+#include "../timers.hpp"
 
 #include <iostream>
 
@@ -23,23 +24,26 @@ namespace reduction {
 		td(_td)
 	{}
 
+	Timings * Timings::clone() const { return new Timings(*this); }
+
 	ostream & Timings::formatHeader(ostream & out) const {
-		out << "cycles, reads, elements, element size, instruction streams" << endl;
+		out << "ticks, ns, reads, elements, element size, instruction streams" << endl;
 		return out;
 	}
 
 	ostream & Timings::formatCSV(ostream & out) const {
-		return sequence(out, td.cycles, td.reads, td.length, td.idx_size, td.istreams);
+		return sequence(out, td.cycles, adhd::timers::Default::ns(td.cycles), td.reads, td.length, td.idx_size, td.istreams);
 	}
 
 	ostream & Timings::formatHuman(ostream & out) const {
 		out << td.length << " elements x " << Bytes(td.idx_size) << " = "
 			<< Bytes(td.length * td.idx_size) << " | " << td.istreams
 			<< " instruction streams" << endl;
-		out << "cycles: " << td.cycles << " | ";
+		out << "ticks: " << td.cycles << " (" << adhd::timers::Default::ns(td.cycles) << " ns) | ";
 		out << "reads: " << td.reads << " (" << Bytes(td.reads * td.idx_size) << ")" << endl;
-		out << "~cycles per read: "
-			<< (double) td.cycles / (double) td.reads << endl;
+		out << "~ticks per read: "
+			<< (double) td.cycles / (double) td.reads
+			<< " (" << adhd::timers::Default::ns(td.cycles) / (double) td.reads << " ns)" << endl;
 		return out;
 	}
 
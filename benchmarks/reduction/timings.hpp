@@ -9,6 +9,7 @@
 namespace reduction {
 
 	struct TimingData {
+		// timer ticks (see adhd::timers), not core cycles
 		uint64_t cycles;
 		uint64_t reads;
 		size_t length;
@@ -20,6 +21,7 @@ namespace reduction {
 	class Timings: public adhd::Timings {
 		public:
 			Timings(const TimingData & td);
+			virtual Timings * clone() const override;
 			virtual std::ostream & formatHeader(std::ostream & out) const override;
 			virtual std::ostream & formatCSV(std::ostream & out) const override;
 			virtual std::ostream & formatHuman(std::ostream & out) const override;
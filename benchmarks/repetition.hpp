@@ -0,0 +1,55 @@
+#pragma once
+
+#include "benchmark.hpp"
+#include "statistics.hpp"
+#include "timings.hpp"
+
+#include <functional>
+#include <memory>
+
+namespace adhd {
+
+	// Measurement driver: runs every point of a benchmark's sweep repeatedly, as
+	// long as the stopping rule (see statistics::Repetition) asks for more. Every
+	// timings row a run reports is a sample, its value given by 'measure';
+	// threaded benchmarks thus contribute a sample per thread and run.
+	class Repeater {
+		public:
+			typedef std::function<double(const Timings &)> measure_fn;
+			typedef std::function<void(const statistics::Summary &)> summary_cb;
+
+			Repeater(measure_fn _measure,
+					const statistics::Repetition & _repetition = statistics::Repetition())
+				: measure(_measure), repetition(_repetition)
+			{}
+
+			// every row of every run is passed on to tcb, a summary of every point to
+			// scb
+			template <typename B>
+				void run(B & b, timing_cb tcb, summary_cb scb) {
+					for (auto & point: b) {
+						std::unique_ptr<statistics::Summary> summary;
+						const timing_cb sample = [&] (const Timings & t) {
+							repetition.add(measure(t));
+							summary.reset(new statistics::Summary(t));
+							tcb(t);
+						};
+
+						repetition.restart();
+						do
+							point.run(sample);
+						while (!repetition.endRun());
+						// points may report no rows, e.g. when skipped as unsupported
+						if (summary) {
+							summary->setData(repetition.summary());
+							scb(*summary);
+						}
+					}
+				}
+
+		private:
+			const measure_fn measure;
+			statistics::Repetition repetition;
+	};
+
+}
@@ -0,0 +1,198 @@
+#include "statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+/* see arraywalk_threaded/timings.cpp */
+#ifdef __INTEL_COMPILER
+#pragma warning(disable:869)
+#endif
+
+namespace adhd {
+	namespace statistics {
+
+		// the MAD of normally distributed samples is this fraction of their
+		// standard deviation
+		static constexpr double MAD_NORMAL = 0.6745;
+
+		// once past the first runs, Repetition judges the interval again only
+		// when the runs grew by this fraction (1 / RUNS_PER_JUDGEMENT) since
+		// the last judgement: every judgement bootstraps all samples
+		static constexpr unsigned RUNS_PER_JUDGEMENT = 8;
+
+		double quantile(const vector<double> & sorted, double q) {
+			if (sorted.empty())
+				return 0;
+			const double rank = q * static_cast<double>(sorted.size() - 1);
+			const size_t lo = static_cast<size_t>(floor(rank));
+			const size_t hi = min(lo + 1, sorted.size() - 1);
+			return sorted[lo] + (rank - static_cast<double>(lo)) * (sorted[hi] - sorted[lo]);
+		}
+
+		// median as quantile(sorted, 0.5) would interpolate it, partially
+		// reordering the samples instead of sorting them
+		static double selectMedian(vector<double> & samples) {
+			if (samples.empty())
+				return 0;
+			const auto mid = samples.begin() + static_cast<ptrdiff_t>(samples.size() / 2);
+			nth_element(samples.begin(), mid, samples.end());
+			if (samples.size() % 2)
+				return *mid;
+			// the lower middle is the largest sample before mid
+			return (*max_element(samples.begin(), mid) + *mid) / 2;
+		}
+
+		double median(vector<double> samples) {
+			return selectMedian(samples);
+		}
+
+		double mad(const vector<double> & samples, double med) {
+			vector<double> deviations;
+			deviations.reserve(samples.size());
+			for (const double s: samples)
+				deviations.push_back(fabs(s - med));
+			return median(deviations);
+		}
+
+		size_t discardOutliers(vector<double> & samples, double limit) {
+			const double med = median(samples);
+			const double dev = mad(samples, med);
+			// all but a few samples are equal: nothing sticks out
+			if (dev <= 0)
+				return 0;
+			const auto outlier = [&] (double s) { return MAD_NORMAL * fabs(s - med) / dev > limit; };
+			const size_t before = samples.size();
+			samples.erase(remove_if(samples.begin(), samples.end(), outlier), samples.end());
+			return before - samples.size();
+		}
+
+		pair<double, double> bootstrapMedian(const vector<double> & samples,
+				double confidence, unsigned resamples, mt19937_64 & rng)
+		{
+			if (samples.size() < 2)
+				return make_pair(samples.empty() ? 0 : samples[0], samples.empty() ? 0 : samples[0]);
+
+			uniform_int_distribution<size_t> pick(0, samples.size() - 1);
+			vector<double> resample(samples.size());
+			vector<double> medians;
+			medians.reserve(resamples);
+			for (unsigned r = 0; r < resamples; ++r) {
+				for (auto & s: resample)
+					s = samples[pick(rng)];
+				medians.push_back(selectMedian(resample));
+			}
+			sort(medians.begin(), medians.end());
+			const double tail = (1 - confidence) / 2;
+			return make_pair(quantile(medians, tail), quantile(medians, 1 - tail));
+		}
+
+		SummaryData summarize(vector<double> samples, double confidence,
+				unsigned resamples, mt19937_64 & rng)
+		{
+			SummaryData sd {};
+			sd.samples = samples.size();
+			sd.outliers = discardOutliers(samples);
+			sd.confidence = confidence;
+			sort(samples.begin(), samples.end());
+			sd.median = quantile(samples, 0.5);
+			sd.p5 = quantile(samples, 0.05);
+			sd.p95 = quantile(samples, 0.95);
+			sd.mad = mad(samples, sd.median);
+			tie(sd.ciLow, sd.ciHigh) = bootstrapMedian(samples, confidence, resamples, rng);
+			return sd;
+		}
+
+		Repetition::Repetition(double _width, double _confidence, unsigned _min_runs,
+				unsigned _max_runs, double _cap, unsigned _resamples):
+			width(_width),
+			confidence(_confidence),
+			min_runs(_min_runs < 1 ? 1 : _min_runs),
+			max_runs(_max_runs < min_runs ? min_runs : _max_runs),
+			cap(_cap),
+			resamples(_resamples),
+			samples(),
+			runs(0),
+			start(chrono::steady_clock::now()),
+			sd(),
+			judgeAt(0),
+			rng()
+		{
+			if (confidence <= 0 || confidence >= 1)
+				throw domain_error(CONFIDENCE_RANGE);
+		}
+
+		void Repetition::restart() {
+			samples.clear();
+			runs = 0;
+			start = chrono::steady_clock::now();
+			sd = SummaryData();
+			judgeAt = 0;
+		}
+
+		void Repetition::add(double sample) {
+			samples.push_back(sample);
+		}
+
+		bool Repetition::endRun() {
+			using namespace chrono;
+			++runs;
+			const double seconds = duration<double>(steady_clock::now() - start).count();
+			// nothing to judge: the point reports no rows at all
+			if (samples.empty())
+				return true;
+			const bool capped = runs >= max_runs || seconds >= cap;
+			if (!capped && (runs < min_runs || runs < judgeAt))
+				return false;
+			sd = summarize(samples, confidence, resamples, rng);
+			sd.runs = runs;
+			sd.seconds = seconds;
+			sd.converged = ciWidth(sd) <= width;
+			judgeAt = runs + max(1u, runs / RUNS_PER_JUDGEMENT);
+			return sd.converged || capped;
+		}
+
+		Summary::Summary(const Timings & last):
+			sd(), lastHeader(), lastCSV(), lastHuman()
+		{
+			ostringstream header, csv, human;
+			last.formatHeader(header);
+			last.formatCSV(csv);
+			last.formatHuman(human);
+			// the summary continues the header and CSV lines
+			lastHeader = header.str();
+			lastHeader.erase(lastHeader.find_last_not_of('\n') + 1);
+			lastCSV = csv.str();
+			lastCSV.erase(lastCSV.find_last_not_of('\n') + 1);
+			lastHuman = human.str();
+		}
+
+		Summary * Summary::clone() const { return new Summary(*this); }
+
+		ostream & Summary::formatHeader(ostream & out) const {
+			return out << lastHeader << ", runs, samples, outliers, median, p5, p95, mad, "
+				"confidence, ci low, ci high, seconds, converged" << endl;
+		}
+
+		ostream & Summary::formatCSV(ostream & out) const {
+			return sequence(out << lastCSV << ",", sd.runs, sd.samples, sd.outliers,
+					sd.median, sd.p5, sd.p95, sd.mad, sd.confidence, sd.ciLow, sd.ciHigh,
+					sd.seconds, sd.converged);
+		}
+
+		ostream & Summary::formatHuman(ostream & out) const {
+			out << lastHuman;
+			out << "runs: " << sd.runs << " | samples: " << sd.samples
+				<< " (" << sd.outliers << " outliers discarded) | " << sd.seconds << " s"
+				<< (sd.converged ? "" : " (capped)") << endl;
+			out << "median: " << sd.median << " | " << sd.confidence * 100 << "% CI ["
+				<< sd.ciLow << ", " << sd.ciHigh << "] | p5: " << sd.p5 << " | p95: "
+				<< sd.p95 << " | MAD: " << sd.mad << endl;
+			return out;
+		}
+
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "timings.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Robust statistics over repeated measurements of a single sweep point.
+namespace adhd {
+	namespace statistics {
+
+		namespace defaults {
+			// relative width of the confidence interval of the median to stop at
+			static constexpr double width = 0.02;
+			static constexpr double confidence = 0.95;
+			static constexpr unsigned min_runs = 5;
+			static constexpr unsigned max_runs = 1000;
+			// seconds spent on a single point before giving up on convergence
+			static constexpr double cap = 10;
+			static constexpr unsigned resamples = 1000;
+		}
+
+		static const char CONFIDENCE_RANGE[] = "Confidence level is not between 0 and 1.";
+
+		// samples with a modified z-score (Iglewicz and Hoaglin) beyond this limit
+		// are outliers
+		static constexpr double OUTLIER_LIMIT = 3.5;
+
+		// q-quantile (0 <= q <= 1) of sorted samples, interpolating linearly
+		// between the closest ranks
+		double quantile(const std::vector<double> & sorted, double q);
+
+		double median(std::vector<double> samples);
+
+		// median absolute deviation from the given median
+		double mad(const std::vector<double> & samples, double median);
+
+		// removes the outliers from samples, returning how many there were
+		size_t discardOutliers(std::vector<double> & samples, double limit = OUTLIER_LIMIT);
+
+		// percentile bootstrap confidence interval of the median
+		std::pair<double, double> bootstrapMedian(const std::vector<double> & samples,
+				double confidence, unsigned resamples, std::mt19937_64 & rng);
+
+		struct SummaryData {
+			uint64_t runs;
+			uint64_t samples;
+			uint64_t outliers;
+			double median;
+			double p5;
+			double p95;
+			double mad;
+			double confidence;
+			double ciLow;
+			double ciHigh;
+			double seconds;
+			// whether the confidence interval got narrow enough, as opposed to
+			// running into the run count or time cap
+			bool converged;
+		};
+		static_assert(std::is_pod<SummaryData>::value, "struct SummaryData must be a POD");
+
+		// statistics of the samples left after discarding outliers
+		SummaryData summarize(std::vector<double> samples, double confidence,
+				unsigned resamples, std::mt19937_64 & rng);
+
+		// relative width of the confidence interval
+		inline double ciWidth(const SummaryData & sd) {
+			return (sd.ciHigh - sd.ciLow) / sd.median;
+		}
+
+		// Stopping rule for repeated runs of a single point: stop once the
+		// bootstrap confidence interval of the median of the samples is narrower
+		// than 'width' relative to the median, or after 'max_runs' runs or 'cap'
+		// seconds, but never before 'min_runs' runs. A run may add any number of
+		// samples; outliers are discarded before judging the interval. Past a few
+		// runs the interval is judged only every so many runs (about an eighth
+		// of the runs so far), bootstrapping being costly for many samples.
+		class Repetition {
+			public:
+				Repetition(
+						double _width         = defaults::width,
+						double _confidence    = defaults::confidence,
+						unsigned _min_runs    = defaults::min_runs,
+						unsigned _max_runs    = defaults::max_runs,
+						double _cap           = defaults::cap,
+						unsigned _resamples   = defaults::resamples);
+
+				// forget all samples, for the next point
+				void restart();
+				void add(double sample);
+				// ends a run, returning whether the point is done
+				bool endRun();
+
+				// valid once endRun() returned true
+				inline const SummaryData & summary() const { return sd; }
+
+			private:
+				const double width;
+				const double confidence;
+				const unsigned min_runs;
+				const unsigned max_runs;
+				const double cap;
+				const unsigned resamples;
+
+				std::vector<double> samples;
+				unsigned runs;
+				std::chrono::steady_clock::time_point start;
+				SummaryData sd;
+				// runs before the interval is judged again
+				unsigned judgeAt;
+				// fixed seed: resampling is reproducible
+				std::mt19937_64 rng;
+		};
+
+		// The row of the last sample of a point (identifying the point), followed
+		// by a summary of all its samples. The row is formatted right away, so
+		// the summary may outlive it.
+		class Summary: public Timings {
+			public:
+				Summary(const Timings & last);
+				virtual Summary * clone() const override;
+				virtual std::ostream & formatHeader(std::ostream & out) const override;
+				virtual std::ostream & formatCSV(std::ostream & out) const override;
+				virtual std::ostream & formatHuman(std::ostream & out) const override;
+
+				inline const SummaryData & data() const { return sd; }
+				inline void setData(const SummaryData & _sd) { sd = _sd; }
+
+			private:
+				SummaryData sd;
+				std::string lastHeader;
+				std::string lastCSV;
+				std::string lastHuman;
+		};
+
+	}
+}
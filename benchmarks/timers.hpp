@@ -0,0 +1,154 @@
+#pragma once
+
+#include "rdtsc.h"
+
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+
+#include <cpuid.h>
+
+#ifdef ADHD_PAPI
+#include <papi.h>
+#endif
+
+// Timer policies for the measurement kernels. A policy provides
+//   static uint64_t now()         - a tick count from a monotonic source
+//   static double ns(uint64_t)    - the duration of a number of ticks in ns
+//   static const char * name()
+// The TSC based policies count reference ticks at the (calibrated) TSC
+// frequency, not core clock cycles: with frequency scaling or turbo both
+// differ.
+namespace adhd {
+	namespace timers {
+
+		// TSC frequency and whether the TSC runs at a constant rate regardless of
+		// frequency and power states (CPUID.80000007H:EDX[8]).
+		struct Tsc {
+			double GHz;
+			bool invariant;
+		};
+
+		inline std::ostream & operator<<(std::ostream & os, const Tsc & tsc) {
+			return os << "TSC " << tsc.GHz << " GHz ("
+				<< (tsc.invariant ? "invariant" : "not invariant") << ")";
+		}
+
+		inline uint64_t monotonicRawNs() {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+			return static_cast<uint64_t>(ts.tv_sec) * 1000000000 +
+				static_cast<uint64_t>(ts.tv_nsec);
+		}
+
+		// rdtscp waits for all preceding instructions to execute, the lfence
+		// keeps later ones from starting before the TSC is read
+		inline uint64_t rdtscp() {
+			uint32_t lo, hi;
+			asm volatile ("rdtscp\n\tlfence" : "=a"(lo), "=d"(hi) :: "rcx", "memory");
+			return lo | ((uint64_t) hi << 32);
+		}
+
+		// lfence on both sides: the TSC read neither overtakes preceding nor
+		// is overtaken by following instructions
+		inline uint64_t rdtscLfence() {
+			uint32_t lo, hi;
+			asm volatile ("lfence\n\trdtsc\n\tlfence" : "=a"(lo), "=d"(hi) :: "memory");
+			return lo | ((uint64_t) hi << 32);
+		}
+
+		namespace calibration {
+			static constexpr uint64_t PERIOD_NS = 20 * 1000 * 1000;
+
+			// TSC ticks elapsed against CLOCK_MONOTONIC_RAW over PERIOD_NS
+			inline Tsc measure() {
+				unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+				const bool invariant = __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) &&
+					(edx & (1 << 8));
+
+				const uint64_t nsStart = monotonicRawNs();
+				const uint64_t tscStart = rdtscp();
+				uint64_t nsEnd;
+				do
+					nsEnd = monotonicRawNs();
+				while (nsEnd - nsStart < PERIOD_NS);
+				const uint64_t tscEnd = rdtscp();
+
+				return Tsc { (double) (tscEnd - tscStart) / (double) (nsEnd - nsStart),
+					invariant };
+			}
+		}
+
+		// calibrated on first use, which every benchmark does at startup
+		inline const Tsc & tsc() {
+			static const Tsc calibrated = calibration::measure();
+			return calibrated;
+		}
+
+		inline double tscNs(uint64_t ticks) { return (double) ticks / tsc().GHz; }
+
+		// plain rdtsc: cheap, but may be reordered with the measured code
+		struct Rdtsc {
+			static inline uint64_t now() { return rdtsc(); }
+			static inline double ns(uint64_t ticks) { return tscNs(ticks); }
+			static inline const char * name() { return "rdtsc"; }
+		};
+
+		struct RdtscLfence {
+			static inline uint64_t now() { return rdtscLfence(); }
+			static inline double ns(uint64_t ticks) { return tscNs(ticks); }
+			static inline const char * name() { return "lfence+rdtsc"; }
+		};
+
+		struct Rdtscp {
+			static inline uint64_t now() { return rdtscp(); }
+			static inline double ns(uint64_t ticks) { return tscNs(ticks); }
+			static inline const char * name() { return "rdtscp"; }
+		};
+
+		// a system call (or vDSO call) per reading: only suited to long kernels
+		struct MonotonicRaw {
+			static inline uint64_t now() { return monotonicRawNs(); }
+			static inline double ns(uint64_t ticks) { return (double) ticks; }
+			static inline const char * name() { return "clock_gettime(CLOCK_MONOTONIC_RAW)"; }
+		};
+
+#ifdef ADHD_PAPI
+		// PAPI real cycles are TSC ticks on x86
+		struct PapiRealCycles {
+			static inline uint64_t now() { return static_cast<uint64_t>(PAPI_get_real_cyc()); }
+			static inline double ns(uint64_t ticks) { return tscNs(ticks); }
+			static inline const char * name() { return "PAPI real cycles"; }
+		};
+#endif
+
+		// the timer used by all benchmarks, e.g. CXXFLAGS=-DADHD_TIMER=Rdtscp
+#ifndef ADHD_TIMER
+#define ADHD_TIMER RdtscLfence
+#endif
+		typedef ADHD_TIMER Default;
+
+		// cost of reading the timer itself, the smallest difference between two
+		// consecutive readings; measured once per timer
+		template <typename TIMER = Default>
+			uint64_t overhead() {
+				static const uint64_t measured = [] {
+					uint64_t least = ~uint64_t(0);
+					for (unsigned i = 0; i < 1000; ++i) {
+						const uint64_t start = TIMER::now();
+						const uint64_t elapsed = TIMER::now() - start;
+						if (elapsed < least)
+							least = elapsed;
+					}
+					return least;
+				}();
+				return measured;
+			}
+
+		// describes the timer in use, calibrating the TSC if not done yet
+		template <typename TIMER = Default>
+			std::ostream & describe(std::ostream & os) {
+				return os << "timer: " << TIMER::name() << " | " << tsc();
+			}
+	}
+}
@@ -10,6 +10,12 @@ namespace adhd {
 	class Timings: public prettyprint::CSV, public prettyprint::Human {
 		public:
 			virtual ~Timings() = default;
+			// a copy of the concrete timings, to keep them past the scope of the
+			// code that reported them
+			virtual Timings * clone() const = 0;
+			// overwrite these timings with a copy of 'other' if it is of the same
+			// concrete type, reusing their storage; false otherwise, and by default
+			virtual bool assign(const Timings &) { return false; }
 			virtual std::ostream & formatHeader(std::ostream & out) const override = 0;
 			virtual std::ostream & formatCSV(std::ostream & out) const override = 0;
 			virtual std::ostream & formatHuman(std::ostream & out) const override = 0;
@@ -0,0 +1,233 @@
+#include "topology.hpp"
+
+#include "hierarchy.hpp"
+#include "numa.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <utility>
+
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+namespace adhd {
+	namespace topology {
+
+		static const char CPU_ROOT[] = "/sys/devices/system/cpu/";
+		static const char NO_ALLOWED_CPUS[] = "cpuOrder(): no allowed cpus";
+		static const char NO_SMT_PAIRS[] =
+			"cpuOrder(): no core with two allowed hardware threads for SMT pairs";
+
+		ostream & operator<<(ostream & os, const Relation & r) {
+			const char * str;
+			switch (r) {
+				case Relation::SAME: str = "same"; break;
+				case Relation::SMT: str = "smt"; break;
+				case Relation::LLC: str = "llc"; break;
+				case Relation::PACKAGE: str = "package"; break;
+				case Relation::REMOTE: str = "remote"; break;
+				default: str = "<unknown>"; break;
+			}
+			return os << str;
+		}
+
+		ostream & operator<<(ostream & os, const Affinity & a) {
+			const char * str;
+			switch (a) {
+				case Affinity::COMPACT: str = "compact"; break;
+				case Affinity::SCATTER_SOCKET: str = "scatter by socket"; break;
+				case Affinity::SCATTER_LLC: str = "scatter by LLC"; break;
+				case Affinity::PHYSICAL_CORES: str = "physical cores"; break;
+				case Affinity::SMT_PAIRS: str = "SMT pairs"; break;
+				default: str = "<unknown>"; break;
+			}
+			return os << str;
+		}
+
+		template <typename T>
+			static bool readValue(const string & path, T & value) {
+				ifstream sysfs(path);
+				return static_cast<bool>(sysfs >> value);
+			}
+
+		vector<unsigned> onlineCpus() {
+			string list;
+			if (!readValue(string(CPU_ROOT) + "online", list))
+				return vector<unsigned>(1, 0);
+			return numa::parseList(list);
+		}
+
+		CpuInfo cpuInfo(unsigned cpu) {
+			stringstream dir;
+			dir << CPU_ROOT << "cpu" << cpu << "/topology/";
+
+			CpuInfo ci { cpu, -1, -1, -1, numa::cpuNode(cpu), {} };
+			string siblings;
+			readValue(dir.str() + "physical_package_id", ci.package);
+			readValue(dir.str() + "core_id", ci.core);
+			if (readValue(dir.str() + "thread_siblings_list", siblings))
+				ci.siblings = numa::parseList(siblings);
+			else
+				ci.siblings.push_back(cpu);
+
+			// the caches are sorted by level: the last one is the LLC
+			const auto caches = sysfsCaches(cpu);
+			if (!caches.empty() && !caches.back().sharedCpus.empty())
+				ci.llc = static_cast<int>(*min_element(caches.back().sharedCpus.begin(),
+							caches.back().sharedCpus.end()));
+			return ci;
+		}
+
+		vector<unsigned> allowedCpus() {
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset))
+				throw system_error(errno, generic_category(), strerror(errno));
+			vector<unsigned> allowed;
+			for (const auto cpu: onlineCpus())
+				if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &cpuset))
+					allowed.push_back(cpu);
+			return allowed;
+		}
+
+		// an allowed cpu, with the rank among the allowed hardware threads of its
+		// core (0 for the first)
+		struct Slot {
+			unsigned cpu;
+			int package;
+			int llc;
+			int core;
+			unsigned smt;
+		};
+
+		static vector<Slot> readSlots() {
+			const auto allowed = allowedCpus();
+			vector<Slot> slots;
+			for (const auto cpu: allowed) {
+				const CpuInfo ci = cpuInfo(cpu);
+				unsigned smt = 0;
+				for (const auto sibling: ci.siblings)
+					if (sibling < cpu && find(allowed.begin(), allowed.end(), sibling) != allowed.end())
+						++smt;
+				slots.push_back(Slot { cpu, ci.package, ci.llc, ci.core, smt });
+			}
+			return slots;
+		}
+
+		static bool compact(const Slot & a, const Slot & b) {
+			return tie(a.package, a.llc, a.core, a.smt, a.cpu)
+				< tie(b.package, b.llc, b.core, b.smt, b.cpu);
+		}
+
+		// every core before any second hardware thread
+		static bool coresFirst(const Slot & a, const Slot & b) {
+			return tie(a.smt, a.package, a.llc, a.core, a.cpu)
+				< tie(b.smt, b.package, b.llc, b.core, b.cpu);
+		}
+
+		// round robin over the groups of slots sharing a package (and LLC), each
+		// group taken in coresFirst order
+		static vector<Slot> scatter(vector<Slot> slots, bool byLLC) {
+			sort(slots.begin(), slots.end(), coresFirst);
+			map<pair<int, int>, vector<Slot>> groups;
+			for (const auto & s: slots)
+				groups[make_pair(s.package, byLLC ? s.llc : 0)].push_back(s);
+
+			vector<Slot> order;
+			for (size_t round = 0; order.size() < slots.size(); ++round)
+				for (const auto & g: groups)
+					if (round < g.second.size())
+						order.push_back(g.second[round]);
+			return order;
+		}
+
+		vector<unsigned> cpuOrder(Affinity a) {
+			static const vector<Slot> model = readSlots();
+			if (model.empty())
+				throw runtime_error(NO_ALLOWED_CPUS);
+
+			vector<Slot> slots;
+			switch (a) {
+				case Affinity::SCATTER_SOCKET:
+					slots = scatter(model, false);
+					break;
+				case Affinity::SCATTER_LLC:
+					slots = scatter(model, true);
+					break;
+				case Affinity::PHYSICAL_CORES:
+					for (const auto & s: model)
+						if (0 == s.smt)
+							slots.push_back(s);
+					sort(slots.begin(), slots.end(), compact);
+					break;
+				case Affinity::SMT_PAIRS:
+					{
+						set<pair<int, int>> paired;
+						for (const auto & s: model)
+							if (1 == s.smt)
+								paired.insert(make_pair(s.package, s.core));
+						for (const auto & s: model)
+							if (s.smt < 2 && paired.count(make_pair(s.package, s.core)))
+								slots.push_back(s);
+					}
+					if (slots.empty())
+						throw runtime_error(NO_SMT_PAIRS);
+					sort(slots.begin(), slots.end(), compact);
+					break;
+				case Affinity::COMPACT:
+				default:
+					slots = model;
+					sort(slots.begin(), slots.end(), compact);
+					break;
+			}
+
+			vector<unsigned> cpus;
+			for (const auto & s: slots)
+				cpus.push_back(s.cpu);
+			return cpus;
+		}
+
+		Relation relation(const CpuInfo & a, const CpuInfo & b) {
+			if (a.cpu == b.cpu)
+				return Relation::SAME;
+			if (find(a.siblings.begin(), a.siblings.end(), b.cpu) != a.siblings.end())
+				return Relation::SMT;
+			if (a.package != b.package)
+				return Relation::REMOTE;
+			if (a.llc >= 0 && a.llc == b.llc)
+				return Relation::LLC;
+			return Relation::PACKAGE;
+		}
+
+		unsigned currentCpu() {
+			const int cpu = sched_getcpu();
+			if (cpu < 0)
+				throw system_error(errno, generic_category(), strerror(errno));
+			return static_cast<unsigned>(cpu);
+		}
+
+		void runOnCpu(unsigned cpu) {
+			runOnCpu(pthread_self(), cpu);
+		}
+
+		void runOnCpu(pthread_t thread, unsigned cpu) {
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			CPU_SET(cpu, &cpuset);
+			const int rc = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+			if (rc)
+				throw system_error(rc, generic_category(), strerror(rc));
+		}
+	}
+}
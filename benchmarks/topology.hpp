@@ -0,0 +1,71 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <pthread.h>
+
+namespace adhd {
+	namespace topology {
+
+		// Placement of a logical cpu as described by the kernel in
+		// /sys/devices/system/cpu/cpuN/{topology,cache}; ids are -1 when unknown.
+		struct CpuInfo {
+			unsigned cpu;
+			int package;
+			int core;
+			// first cpu sharing the last level cache: identifies the LLC (slice or
+			// core complex) the cpu belongs to
+			int llc;
+			unsigned node;
+			// hardware threads of the same core, including the cpu itself
+			std::vector<unsigned> siblings;
+		};
+
+		// How close two cpus are, from sharing everything to sharing nothing but
+		// the coherence protocol:
+		// SAME    - the same logical cpu
+		// SMT     - hardware threads of one core
+		// LLC     - distinct cores sharing the last level cache
+		// PACKAGE - the same package (socket), distinct last level caches
+		// REMOTE  - distinct packages
+		enum class Relation { SAME, SMT, LLC, PACKAGE, REMOTE };
+
+
+		// Orders in which threads are placed on the allowed cpus:
+		// COMPACT        - all hardware threads of a core, then the next cores of
+		//                  the same last level cache, then of the same package
+		// SCATTER_SOCKET - round robin over packages, using every core once before
+		//                  using a core's second hardware thread
+		// SCATTER_LLC    - round robin over last level caches, idem
+		// PHYSICAL_CORES - a single hardware thread per core, in compact order
+		// SMT_PAIRS      - two hardware threads per core, in compact order: cores
+		//                  without an allowed sibling are left out
+		enum class Affinity { COMPACT, SCATTER_SOCKET, SCATTER_LLC, PHYSICAL_CORES, SMT_PAIRS };
+
+		std::ostream & operator<<(std::ostream & os, const Relation & r);
+		std::ostream & operator<<(std::ostream & os, const Affinity & a);
+
+		// online cpus, and their placement
+		std::vector<unsigned> onlineCpus();
+		CpuInfo cpuInfo(unsigned cpu);
+
+		// online cpus the calling thread may run on, i.e. within its affinity mask
+		// and cgroup cpuset
+		std::vector<unsigned> allowedCpus();
+
+		// The allowed cpus in the order of an affinity policy: thread t runs on the
+		// t-th cpu, wrapping around when threads outnumber cpus. The topology is
+		// read on first use.
+		std::vector<unsigned> cpuOrder(Affinity a);
+
+		Relation relation(const CpuInfo & a, const CpuInfo & b);
+
+		// cpu the calling thread is running on
+		unsigned currentCpu();
+
+		// restrict the calling resp. the given thread to a single cpu
+		void runOnCpu(unsigned cpu);
+		void runOnCpu(pthread_t thread, unsigned cpu);
+	}
+}
@@ -1,4 +1,5 @@
 #include "logging.hpp"
+#include "benchmarks/timers.hpp"
 
 #include <assert.h>
 #include <inttypes.h>
@@ -111,6 +112,7 @@ nsec_t logWalkArray(
 			);
 
 	// timing for a single read
+	const double GHz = gn_opt->frequency > 0 ? gn_opt->frequency : adhd::timers::tsc().GHz;
 	nsec_t nsread_old = old_avg / wa_opt->aaccesses;
 	nsec_t nsread_new = new_avg / wa_opt->aaccesses;
 	verbose(options, ">>>\t~%" PRINSEC " nsec/read"
@@ -122,8 +124,8 @@ nsec_t logWalkArray(
 			nsread_new,
 			100 * (double)(nsread_new - nsread_old) / (double)nsread_old,
 			nsread_old, nsread_new,
-			((double)gn_opt->frequency * (double)new_avg) / (double)wa_opt->aaccesses,
-			gn_opt->frequency);
+			(GHz * (double)new_avg) / (double)wa_opt->aaccesses,
+			GHz);
 
 	// bandwidth estimation for a single run
 	double totalbytes = (double)wa_opt->aaccesses * sizeof(walking_t);
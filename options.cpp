@@ -78,7 +78,7 @@ static void set_default_config(config_t * cfg) {
 	static const unsigned BEGIN = BEGIN_INIT;
 	static const char SPAWN[] = "linear";
 	static const long long END = END_INIT;
-	static const float FREQUENCY = 1;
+	static const float FREQUENCY = 0;
 	static const bool LOGGING = false;
 	static const char LOGFILE[] = "adhd_log";
 	static const char PATTERN[] = "random";
@@ -124,9 +124,8 @@ static void set_default_config(config_t * cfg) {
 			}
 		}
 
-		// CPU frequency to calculate cycle estimate
-		// TODO: use actual cycle counter in the CPU
-		// (this is a feature with a design impact, as SMP complicates matters ... :))
+		// CPU frequency to calculate cycle estimate, in GHz
+		// (0 uses the TSC frequency calibrated at startup)
 		setting = config_setting_add(generic, FLD_GENERIC_GPU_FREQUENCY, CONFIG_TYPE_FLOAT);
 		config_setting_set_float(setting, FREQUENCY);
 
@@ -18,7 +18,8 @@ enum pattern_type pattern_typeFromString(const char * pt);
 struct Options_generic {
 	// process Creation
 	enum spawn_type create;
-	// cpu frequency to use in memory access cycles calculation
+	// cpu frequency in GHz to use in memory access cycles calculation, 0 for
+	// the calibrated TSC frequency
 	double frequency;
 	// CSV logging enable/disable
 	bool logging;